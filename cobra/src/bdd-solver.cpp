@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./bdd-solver.h"
+
+#include <cassert>
+#include <climits>
+#include <algorithm>
+#include <vector>
+#include "./compiled-formula.h"
+#include "./formula.h"
+#include "./game.h"
+#include "./common.h"
+
+namespace {
+  const uint kMinGcLimit = 1 << 20;
+}  // namespace
+
+SolverStats BddSolver::stats_ = SolverStats();
+
+BddSolver::BddSolver(uint var_count, Formula* constraint, const Game* game)
+    : bdd_(var_count > 0 ? var_count - 1 : 0),
+      level_(var_count, 0),
+      min_gc_limit_(kMinGcLimit),
+      gc_limit_(kMinGcLimit) {
+  var_count_ = var_count;
+  vec<bool> placed(var_count_, false);
+  auto place = [&](VarId id) {
+    if (id <= 0 || (unsigned)id >= var_count_ || placed[id]) return;
+    placed[id] = true;
+    level_[id] = var_.size();
+    var_.push_back(id);
+  };
+  if (game) {
+    for (uint map = 0; map < game->numMappings(); map++)
+      for (uint c = 0; c < game->alphabet().size(); c++)
+        place(game->getMappingValue(map, c));
+  }
+  for (uint id = 1; id < var_count_; id++) place(id);
+
+  roots_.push_back(Bdd::kTrue);
+  if (constraint) AddConstraint(constraint);
+}
+
+Bdd::Node BddSolver::Build(Formula* formula, const vec<CharId>* params) {
+  CompiledFormula cf(formula, params);
+  auto& code = cf.code();
+  vec<Bdd::Node> regs(code.size());
+  for (uint i = 0; i < code.size(); i++) {
+    auto& ins = code[i];
+    const uint* arg = cf.operands(ins);
+    Bdd::Node r = Bdd::kFalse;
+    switch (ins.op) {
+      case CompiledFormula::kVariable:
+        r = bdd_.Var(level_[ins.value]);
+        break;
+      case CompiledFormula::kNot:
+        r = bdd_.Not(regs[arg[0]]);
+        break;
+      case CompiledFormula::kAnd:
+        r = Bdd::kTrue;
+        for (uint j = 0; j < ins.count; j++) r = bdd_.And(r, regs[arg[j]]);
+        break;
+      case CompiledFormula::kOr:
+        for (uint j = 0; j < ins.count; j++) r = bdd_.Or(r, regs[arg[j]]);
+        break;
+      case CompiledFormula::kImplies:
+        r = bdd_.Implies(regs[arg[0]], regs[arg[1]]);
+        break;
+      case CompiledFormula::kEquivalence:
+        r = bdd_.Equivalent(regs[arg[0]], regs[arg[1]]);
+        break;
+      case CompiledFormula::kAtLeast:
+      case CompiledFormula::kAtMost:
+      case CompiledFormula::kExactly: {
+        // counter[k]: at least k of the operands seen so far are true,
+        // counted up to value + 1 (as in CompiledFormula::Evaluate)
+        uint top = ins.value + 1;
+        vec<Bdd::Node> counter(top + 1, Bdd::kFalse);
+        counter[0] = Bdd::kTrue;
+        for (uint j = 0; j < ins.count; j++) {
+          auto x = regs[arg[j]];
+          for (uint k = std::min(top, j + 1); k > 0; k--)
+            counter[k] = bdd_.Or(counter[k], bdd_.And(counter[k - 1], x));
+        }
+        if (ins.op == CompiledFormula::kAtLeast)
+          r = counter[ins.value];
+        else if (ins.op == CompiledFormula::kAtMost)
+          r = bdd_.Not(counter[top]);
+        else
+          r = bdd_.And(counter[ins.value], bdd_.Not(counter[top]));
+        break;
+      }
+    }
+    regs[i] = r;
+  }
+  return regs.back();
+}
+
+void BddSolver::Add(Bdd::Node f) {
+  roots_.back() = bdd_.And(roots_.back(), f);
+  if (bdd_.size() > gc_limit_) {
+    bdd_.Collect(roots_);
+    gc_limit_ = std::max(min_gc_limit_, 2 * bdd_.size());
+  }
+}
+
+void BddSolver::SetGcLimit(uint nodes) {
+  min_gc_limit_ = gc_limit_ = nodes;
+}
+
+void BddSolver::AddConstraint(Formula* formula) {
+  Add(Build(formula, nullptr));
+}
+
+void BddSolver::AddConstraint(Formula* formula, const vec<CharId>& params) {
+  Add(Build(formula, &params));
+}
+
+void BddSolver::OpenContext() {
+  roots_.push_back(roots_.back());
+}
+
+void BddSolver::CloseContext() {
+  assert(roots_.size() > 1);
+  roots_.pop_back();
+}
+
+bool BddSolver::_MustBeTrue(VarId id) {
+  assert(id > 0 && (unsigned)id < var_count_);
+  auto x = bdd_.Var(level_[id]);
+  return bdd_.And(roots_.back(), bdd_.Not(x)) == Bdd::kFalse;
+}
+
+bool BddSolver::_MustBeFalse(VarId id) {
+  assert(id > 0 && (unsigned)id < var_count_);
+  auto x = bdd_.Var(level_[id]);
+  return bdd_.And(roots_.back(), x) == Bdd::kFalse;
+}
+
+vec<VarId> BddSolver::_GetFixedVars() {
+  vec<bool> can_be;
+  bdd_.Values(roots_.back(), &can_be);
+  vec<VarId> result;
+  for (uint id = 1; id < var_count_; id++) {
+    if (!can_be[2 * level_[id]]) result.push_back(id);
+    if (!can_be[2 * level_[id] + 1]) result.push_back(-id);
+  }
+  return result;
+}
+
+uint BddSolver::_GetNumOfFixedVars() {
+  return _GetFixedVars().size();
+}
+
+bool BddSolver::_Satisfiable() {
+  return roots_.back() != Bdd::kFalse;
+}
+
+bool BddSolver::_OnlyOneModel() {
+  return bdd_.Count(roots_.back()) == 1;
+}
+
+uint BddSolver::_NumOfModels() {
+  return std::min<uint64_t>(bdd_.Count(roots_.back()), UINT_MAX);
+}
+
+vec<bool> BddSolver::ToModel(const vec<bool>& levels) const {
+  vec<bool> model(var_count_, false);
+  for (uint l = 0; l < levels.size(); l++) model[var_[l]] = levels[l];
+  return model;
+}
+
+vec<bool> BddSolver::GetModel() {
+  assert(roots_.back() != Bdd::kFalse);
+  return ToModel(bdd_.AnyModel(roots_.back()));
+}
+
+vec<vec<bool>> BddSolver::_GenerateModels() {
+  vec<vec<bool>> result;
+  for (auto& levels : bdd_.AllModels(roots_.back()))
+    result.push_back(ToModel(levels));
+  // the same order as the enumeration of the other solvers
+  std::sort(result.begin(), result.end());
+  return result;
+}
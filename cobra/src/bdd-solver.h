@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <vector>
+#include "./common.h"
+#include "./solver.h"
+#include "./bdd.h"
+
+#ifndef COBRA_SRC_BDD_SOLVER_H_
+#define COBRA_SRC_BDD_SOLVER_H_
+
+class Formula;
+class Game;
+
+/**
+ * Solver representing the current constraints by a BDD. Every context
+ * keeps the conjunction of all constraints added so far, so closing
+ * a context just drops its BDD. Model counting and fixed variables need
+ * a single pass over the BDD, with no enumeration of models.
+ */
+class BddSolver: public Solver {
+  static SolverStats stats_;
+
+  Bdd bdd_;
+  vec<uint> level_;  // level of every variable in the BDD order
+  vec<VarId> var_;   // variable at every level
+  vec<Bdd::Node> roots_;  // conjunction of the constraints, per context
+  uint min_gc_limit_;
+  uint gc_limit_;  // size of bdd_ that triggers garbage collection
+
+ public:
+  /**
+   * If 'game' is given, the variables of each of its mappings are adjacent
+   * in the variable order (the game constraint usually relates them).
+   */
+  BddSolver(uint var_count, Formula* constraint = nullptr,
+            const Game* game = nullptr);
+
+  SolverStats& stats() { return stats_; }
+  static SolverStats& s_stats() { return stats_; }
+
+  /**
+   * Sets the number of nodes above which unreachable nodes are collected;
+   * after a collection, the limit is at least twice the remaining size.
+   */
+  void SetGcLimit(uint nodes);
+  uint num_nodes() const { return bdd_.size(); }
+
+  void AddConstraint(Formula* formula);
+  void AddConstraint(Formula* formula, const vec<CharId>& params);
+
+  void OpenContext();
+  void CloseContext();
+
+  vec<bool> GetModel();
+
+ private:
+  bool _MustBeTrue(VarId id);
+  bool _MustBeFalse(VarId id);
+  vec<VarId> _GetFixedVars();
+  uint _GetNumOfFixedVars();
+  bool _Satisfiable();
+  bool _OnlyOneModel();
+  uint _NumOfModels();
+  vec<vec<bool>> _GenerateModels();
+
+  Bdd::Node Build(Formula* formula, const vec<CharId>* params);
+  void Add(Bdd::Node f);
+  vec<bool> ToModel(const vec<bool>& levels) const;
+};
+
+#endif  // COBRA_SRC_BDD_SOLVER_H_
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./bdd.h"
+
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "./common.h"
+
+namespace {
+  const uint kCacheSize = 1 << 18;  // must be a power of two
+
+  // x * 2^k, saturated if it does not fit in 64 bits
+  uint64_t shift(uint64_t x, uint k) {
+    if (x == 0) return 0;
+    if (k >= 64 || x > (UINT64_MAX >> k)) return UINT64_MAX;
+    return x << k;
+  }
+}  // namespace
+
+const Bdd::Node Bdd::kFalse;
+const Bdd::Node Bdd::kTrue;
+
+Bdd::Bdd(uint levels)
+    : levels_(levels),
+      cache_(kCacheSize, { kFalse, kFalse, kFalse, kFalse }) {
+  nodes_.push_back({ levels_, kFalse, kFalse });
+  nodes_.push_back({ levels_, kTrue, kTrue });
+}
+
+Bdd::Node Bdd::MakeNode(uint level, Node low, Node high) {
+  if (low == high) return low;
+  NodeData data = { level, low, high };
+  auto it = unique_.find(data);
+  if (it != unique_.end()) return it->second;
+  Node node = nodes_.size();
+  nodes_.push_back(data);
+  unique_[data] = node;
+  return node;
+}
+
+Bdd::Node Bdd::Var(uint level) {
+  assert(level < levels_);
+  return MakeNode(level, kFalse, kTrue);
+}
+
+Bdd::Node Bdd::Ite(Node f, Node g, Node h) {
+  if (f == kTrue) return g;
+  if (f == kFalse) return h;
+  if (g == h) return g;
+  if (g == kTrue && h == kFalse) return f;
+
+  auto& entry = cache_[(f * 12582917u + g * 4256249u + h) & (kCacheSize - 1)];
+  if (entry.f == f && entry.g == g && entry.h == h) return entry.result;
+
+  uint top = std::min(level(f), std::min(level(g), level(h)));
+  auto cofactor = [&](Node x, bool value) {
+    if (level(x) != top) return x;
+    return value ? nodes_[x].high : nodes_[x].low;
+  };
+  Node low = Ite(cofactor(f, false), cofactor(g, false), cofactor(h, false));
+  Node high = Ite(cofactor(f, true), cofactor(g, true), cofactor(h, true));
+  Node result = MakeNode(top, low, high);
+  // 'entry' may have been overwritten by the recursive calls, which is fine
+  entry = { f, g, h, result };
+  return result;
+}
+
+uint64_t Bdd::Count(Node f) const {
+  // count[n]: number of satisfying assignments of levels level(n) and below
+  std::unordered_map<Node, uint64_t> count;
+  count[kFalse] = 0;
+  count[kTrue] = 1;
+  std::function<uint64_t(Node)> rec = [&](Node n) -> uint64_t {
+    auto it = count.find(n);
+    if (it != count.end()) return it->second;
+    auto& d = nodes_[n];
+    auto low = shift(rec(d.low), level(d.low) - d.level - 1);
+    auto high = shift(rec(d.high), level(d.high) - d.level - 1);
+    auto r = low > UINT64_MAX - high ? UINT64_MAX : low + high;
+    count[n] = r;
+    return r;
+  };
+  return shift(rec(f), level(f));
+}
+
+void Bdd::Values(Node f, vec<bool>* can_be) const {
+  can_be->assign(2 * levels_, false);
+  if (f == kFalse) return;
+  // free[l] > 0 (after prefix sums) iff level l is skipped by some edge
+  vec<int> free(levels_ + 1, 0);
+  free[0]++;
+  free[level(f)]--;
+  std::unordered_set<Node> visited;
+  vec<Node> stack = { f };
+  while (!stack.empty()) {
+    auto n = stack.back();
+    stack.pop_back();
+    if (n == kTrue || !visited.insert(n).second) continue;
+    auto& d = nodes_[n];
+    for (auto b : { false, true }) {
+      auto child = b ? d.high : d.low;
+      if (child == kFalse) continue;
+      (*can_be)[2 * d.level + b] = true;
+      free[d.level + 1]++;
+      free[level(child)]--;
+      stack.push_back(child);
+    }
+  }
+  int skipped = 0;
+  for (uint l = 0; l < levels_; l++) {
+    skipped += free[l];
+    if (skipped > 0) (*can_be)[2 * l] = (*can_be)[2 * l + 1] = true;
+  }
+}
+
+vec<bool> Bdd::AnyModel(Node f) const {
+  assert(f != kFalse);
+  vec<bool> model(levels_, false);
+  while (f != kTrue) {
+    auto& d = nodes_[f];
+    model[d.level] = (d.low == kFalse);
+    f = model[d.level] ? d.high : d.low;
+  }
+  return model;
+}
+
+vec<vec<bool>> Bdd::AllModels(Node f) const {
+  vec<vec<bool>> result;
+  vec<bool> model(levels_, false);
+  AllModels(f, 0, model, result);
+  return result;
+}
+
+void Bdd::AllModels(Node f, uint level, vec<bool>& model,
+                    vec<vec<bool>>& result) const {
+  if (f == kFalse) return;
+  if (level == levels_) {
+    result.push_back(model);
+    return;
+  }
+  for (auto b : { false, true }) {
+    model[level] = b;
+    auto next = f;
+    if (this->level(f) == level) next = b ? nodes_[f].high : nodes_[f].low;
+    AllModels(next, level + 1, model, result);
+  }
+  model[level] = false;
+}
+
+void Bdd::Collect(vec<Node>& roots) {
+  vec<bool> reachable(nodes_.size(), false);
+  reachable[kFalse] = reachable[kTrue] = true;
+  vec<Node> stack(roots.begin(), roots.end());
+  while (!stack.empty()) {
+    auto n = stack.back();
+    stack.pop_back();
+    if (reachable[n]) continue;
+    reachable[n] = true;
+    stack.push_back(nodes_[n].low);
+    stack.push_back(nodes_[n].high);
+  }
+
+  // children precede parents, so one pass in index order renumbers all
+  vec<Node> renumber(nodes_.size(), kFalse);
+  renumber[kTrue] = kTrue;
+  vec<NodeData> nodes(nodes_.begin(), nodes_.begin() + 2);
+  unique_.clear();
+  for (Node n = 2; n < nodes_.size(); n++) {
+    if (!reachable[n]) continue;
+    NodeData d = { nodes_[n].level, renumber[nodes_[n].low],
+                   renumber[nodes_[n].high] };
+    renumber[n] = nodes.size();
+    unique_[d] = nodes.size();
+    nodes.push_back(d);
+  }
+  nodes_.swap(nodes);
+  for (auto& r : roots) r = renumber[r];
+  std::fill(cache_.begin(), cache_.end(),
+            CacheEntry { kFalse, kFalse, kFalse, kFalse });
+}
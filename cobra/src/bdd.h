@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "./common.h"
+
+#ifndef COBRA_SRC_BDD_H_
+#define COBRA_SRC_BDD_H_
+
+/**
+ * A small package for reduced ordered binary decision diagrams.
+ * Variables are identified by their level in the order, 0 being the top.
+ * Nodes are identified by their index; kFalse and kTrue are the terminals.
+ * All nodes are created through the unique table, so two nodes represent
+ * the same function if and only if they are equal. Children are always
+ * created before their parents, so they have smaller indices.
+ */
+class Bdd {
+ public:
+  typedef uint Node;
+  static const Node kFalse = 0;
+  static const Node kTrue = 1;
+
+ private:
+  struct NodeData {
+    uint level;  // 'levels_' for the terminals
+    Node low;
+    Node high;
+    bool operator==(const NodeData& o) const {
+      return level == o.level && low == o.low && high == o.high;
+    }
+  };
+  struct NodeHash {
+    size_t operator()(const NodeData& n) const {
+      return (static_cast<size_t>(n.level) * 12582917 + n.low) * 4256249 +
+             n.high;
+    }
+  };
+  // Computed cache for Ite; a direct-mapped table that simply overwrites
+  // colliding entries.
+  struct CacheEntry {
+    Node f, g, h, result;
+  };
+
+  uint levels_;
+  vec<NodeData> nodes_;
+  std::unordered_map<NodeData, Node, NodeHash> unique_;
+  vec<CacheEntry> cache_;
+
+ public:
+  explicit Bdd(uint levels);
+
+  uint levels() const { return levels_; }
+  uint size() const { return nodes_.size(); }
+  uint level(Node f) const { return nodes_[f].level; }
+
+  /**
+   * Returns the function that is true iff the variable at 'level' is.
+   */
+  Node Var(uint level);
+
+  /**
+   * If-then-else: (f & g) | (!f & h). All other operations use this one.
+   */
+  Node Ite(Node f, Node g, Node h);
+
+  Node Not(Node f) { return Ite(f, kFalse, kTrue); }
+  Node And(Node f, Node g) { return Ite(f, g, kFalse); }
+  Node Or(Node f, Node g) { return Ite(f, kTrue, g); }
+  Node Implies(Node f, Node g) { return Ite(f, g, kTrue); }
+  Node Equivalent(Node f, Node g) { return Ite(f, g, Not(g)); }
+
+  /**
+   * Returns the number of satisfying assignments of all levels
+   * (saturated at 2^64 - 1).
+   */
+  uint64_t Count(Node f) const;
+
+  /**
+   * Finds out which values each level takes in the satisfying assignments
+   * of 'f': can_be[2 * level + b] is set iff some assignment gives value b.
+   */
+  void Values(Node f, vec<bool>* can_be) const;
+
+  /**
+   * Returns a satisfying assignment of 'f' (indexed by levels), preferring
+   * false values. 'f' must not be kFalse.
+   */
+  vec<bool> AnyModel(Node f) const;
+
+  /**
+   * Returns all satisfying assignments of 'f' (indexed by levels).
+   */
+  vec<vec<bool>> AllModels(Node f) const;
+
+  /**
+   * Frees all nodes not reachable from 'roots' and renumbers the rest;
+   * the roots are updated to the new numbers. Any other node indices held
+   * by the caller become invalid.
+   */
+  void Collect(vec<Node>& roots);
+
+ private:
+  Node MakeNode(uint level, Node low, Node high);
+  void AllModels(Node f, uint level, vec<bool>& model,
+                 vec<vec<bool>>& result) const;
+};
+
+#endif  // COBRA_SRC_BDD_H_
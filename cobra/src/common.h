@@ -4,6 +4,7 @@
  * found in the LICENSE file.
  */
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -37,6 +38,13 @@ typedef struct Args {
   string stg_outcome;
   bool symmetry_detection;
   double opt_bound;
+  uint outcome_table;  // size limit of the outcome table in MB, 0 = off
+  string cache_dir;
+  uint threads;
+  double approx_epsilon;  // 0 = exact model counting
+  double approx_delta;
+  string cardinality;  // encoding of cardinality constraints to CNF
+  bool preprocess;  // simplify the CNF of the game constraint
 } Args;
 
 template<typename T>
@@ -97,6 +105,21 @@ bool readIntOrString(uint& i, string& str);
  */
 double toSeconds(clock_t time);
 
+/**
+ * Number of set bits in a 64-bit word.
+ */
+inline uint popcount(uint64_t x) {
+  return __builtin_popcountll(x);
+}
+
+/**
+ * Index of the lowest set bit of a non-zero 64-bit word.
+ */
+inline uint ctz(uint64_t x) {
+  assert(x);
+  return __builtin_ctzll(x);
+}
+
 class UnionFind {
   uint* id;
 
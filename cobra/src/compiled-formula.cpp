@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./compiled-formula.h"
+
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include "./formula.h"
+#include "./common.h"
+
+CompiledFormula::CompiledFormula(Formula* formula,
+                                 const vec<CharId>* params) {
+  assert(formula);
+  formula->Compile(*this, params);
+}
+
+uint CompiledFormula::Add(Op op, uint value, const vec<uint>& operands) {
+  code_.push_back({ op, value, static_cast<uint>(args_.size()),
+                    static_cast<uint>(operands.size()) });
+  args_.insert(args_.end(), operands.begin(), operands.end());
+  if (op == kAtLeast || op == kAtMost || op == kExactly)
+    max_value_ = std::max(max_value_, value);
+  return code_.size() - 1;
+}
+
+uint64_t CompiledFormula::Evaluate(const vec<vec<uint64_t>>& columns,
+                                   uint word, vec<uint64_t>& regs) const {
+  assert(!code_.empty());
+  // registers for instructions, followed by counters for cardinality ops
+  regs.resize(code_.size() + max_value_ + 2);
+  uint64_t* counter = regs.data() + code_.size();
+  for (uint i = 0; i < code_.size(); i++) {
+    auto& ins = code_[i];
+    const uint* arg = args_.data() + ins.first;
+    uint64_t r = 0;
+    switch (ins.op) {
+      case kVariable:
+        r = columns[ins.value][word];
+        break;
+      case kNot:
+        r = ~regs[arg[0]];
+        break;
+      case kAnd:
+        r = ~uint64_t(0);
+        for (uint j = 0; j < ins.count; j++) r &= regs[arg[j]];
+        break;
+      case kOr:
+        for (uint j = 0; j < ins.count; j++) r |= regs[arg[j]];
+        break;
+      case kImplies:
+        r = ~regs[arg[0]] | regs[arg[1]];
+        break;
+      case kEquivalence:
+        r = ~(regs[arg[0]] ^ regs[arg[1]]);
+        break;
+      case kAtLeast:
+      case kAtMost:
+      case kExactly: {
+        // counter[k] has bit set iff at least k of the operands seen so far
+        // are true in the corresponding code; counted up to value + 1
+        uint top = ins.value + 1;
+        counter[0] = ~uint64_t(0);
+        std::fill(counter + 1, counter + top + 1, 0);
+        for (uint j = 0; j < ins.count; j++) {
+          auto x = regs[arg[j]];
+          for (uint k = std::min(top, j + 1); k > 0; k--)
+            counter[k] |= counter[k - 1] & x;
+        }
+        if (ins.op == kAtLeast)
+          r = counter[ins.value];
+        else if (ins.op == kAtMost)
+          r = ~counter[top];
+        else
+          r = counter[ins.value] & ~counter[top];
+        break;
+      }
+    }
+    regs[i] = r;
+  }
+  return regs[code_.size() - 1];
+}
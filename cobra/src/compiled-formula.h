@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "./common.h"
+
+#ifndef COBRA_SRC_COMPILED_FORMULA_H_
+#define COBRA_SRC_COMPILED_FORMULA_H_
+
+class Formula;
+
+/**
+ * A formula under a fixed parametrization, compiled to a flat list of
+ * instructions over 64-bit words. Evaluation works on a bit-sliced code set
+ * (one bitset over all codes per variable, see SimpleSolver) and evaluates
+ * the formula for 64 codes at once.
+ * Instruction i stores its result in register i; operands are registers
+ * of previous instructions, so the last instruction holds the result.
+ */
+class CompiledFormula {
+ public:
+  enum Op {
+    kVariable,     // column of variable 'value'
+    kNot,
+    kAnd,
+    kOr,
+    kImplies,
+    kEquivalence,
+    kAtLeast,      // at least 'value' operands are true
+    kAtMost,       // at most 'value' operands are true
+    kExactly       // exactly 'value' operands are true
+  };
+
+  struct Instruction {
+    Op op;
+    uint value;
+    uint first;  // operands are args_[first, first + count)
+    uint count;
+  };
+
+ private:
+  vec<Instruction> code_;
+  vec<uint> args_;
+  uint max_value_ = 0;
+
+ public:
+  /**
+   * Compiles 'formula' under parametrization 'params' (may be nullptr
+   * for non-parametrized formulas).
+   */
+  CompiledFormula(Formula* formula, const vec<CharId>* params);
+
+  /**
+   * Appends an instruction and returns its register.
+   */
+  uint Add(Op op, uint value, const vec<uint>& operands);
+
+  uint size() const { return code_.size(); }
+
+  /**
+   * Gets the instructions and their operands, for evaluation on other
+   * domains than bitsets (see BddSolver).
+   */
+  const vec<Instruction>& code() const { return code_; }
+  const uint* operands(const Instruction& ins) const {
+    return args_.data() + ins.first;
+  }
+
+  /**
+   * Evaluates the formula for the 64 codes in word 'word' of the bit-sliced
+   * code set 'columns'. 'regs' is a scratch buffer owned by the caller, so
+   * that several threads can evaluate the same formula concurrently.
+   * Bit i of the result is set iff code 64 * word + i satisfies the formula.
+   */
+  uint64_t Evaluate(const vec<vec<uint64_t>>& columns, uint word,
+                    vec<uint64_t>& regs) const;
+};
+
+#endif  // COBRA_SRC_COMPILED_FORMULA_H_
@@ -35,11 +35,9 @@ Experiment::Experiment(Solver& solver, const ExpType& e,
 bool Experiment::IsSat(uint id) {
   assert(id < data_.size());
   if (!data_[id].sat_c) {
-    solver_->OpenContext();
-    solver_->AddConstraint(type_->outcomes()[id].formula, params_);
-    data_[id].sat = solver_->Satisfiable();
+    data_[id].sat = solver_->SatisfiableWith(type_->outcomes()[id].formula,
+                                             params_);
     data_[id].sat_c = true;
-    solver_->CloseContext();
   }
   return data_[id].sat;
 }
@@ -60,7 +58,10 @@ uint Experiment::NumOfSat() {
 
 uint Experiment::NumOfModels(uint id) {
   assert(id < data_.size());
-  if (!data_[id].models_c) {
+  if (data_[id].models_c) return data_[id].models;
+  if (solver_->PartitionsInOnePass()) {
+    Partition(false);
+  } else {
     solver_->OpenContext();
     solver_->AddConstraint(type_->outcomes()[id].formula, params_);
     data_[id].models = solver_->NumOfModels();
@@ -72,6 +73,32 @@ uint Experiment::NumOfModels(uint id) {
   return data_[id].models;
 }
 
+bool Experiment::NumOfModelsAtLeast(uint id, uint k) {
+  assert(id < data_.size());
+  auto& data = data_[id];
+  if (data.models_c) return static_cast<uint>(data.models) >= k;
+  if (data.models_at_least >= k) return true;
+  // a single pass (or an outcome table column) counts all outcomes exactly
+  // for less than bounded counting of this one
+  if (solver_->PartitionsInOnePass()) {
+    Partition(false);
+    return static_cast<uint>(data.models) >= k;
+  }
+  solver_->OpenContext();
+  solver_->AddConstraint(type_->outcomes()[id].formula, params_);
+  auto models = solver_->NumOfModelsUpTo(k);
+  solver_->CloseContext();
+  if (models >= k) {
+    data.models_at_least = k;
+    return true;
+  }
+  data.models = models;
+  data.models_c = true;
+  data.sat = models > 0;
+  data.sat_c = true;
+  return false;
+}
+
 uint Experiment::TotalNumOfModels() {
   uint total = 0;
   for (uint i = 0; i < data_.size(); i++)
@@ -88,7 +115,10 @@ uint Experiment::MaxNumOfModels() {
 
 uint Experiment::NumOfFixedVars(uint id) {
   assert(id < data_.size());
-  if (!data_[id].fixed_c) {
+  if (data_[id].fixed_c) return data_[id].fixed;
+  if (solver_->PartitionsInOnePass()) {
+    Partition(true);
+  } else {
     solver_->OpenContext();
     solver_->AddConstraint(type_->outcomes()[id].formula, params_);
     data_[id].fixed = solver_->GetNumOfFixedVars();
@@ -98,6 +128,26 @@ uint Experiment::NumOfFixedVars(uint id) {
   return data_[id].fixed;
 }
 
+void Experiment::Partition(bool fixed) {
+  vec<uint> result;
+  if (fixed) {
+    solver_->PartitionByOutcome(*type_, params_, nullptr, &result);
+  } else {
+    solver_->PartitionByOutcome(*type_, params_, &result);
+  }
+  for (uint i = 0; i < data_.size(); i++) {
+    if (fixed) {
+      data_[i].fixed = result[i];
+      data_[i].fixed_c = true;
+    } else {
+      data_[i].models = result[i];
+      data_[i].models_c = true;
+      data_[i].sat = data_[i].models > 0;
+      data_[i].sat_c = true;
+    }
+  }
+}
+
 string Experiment::pretty() {
     return type().name() + " " + type().game().ParamsToStr(params_);
 }
@@ -160,6 +210,31 @@ uint64_t ExpType::NumberOfParametrizations() const {
   return total;
 }
 
+void ExpType::ForAllParametrizations(
+    std::function<void(const vec<CharId>&)> callback) const {
+  vec<CharId> params(num_params_);
+  ForAllParametrizations(params, 0, callback);
+}
+
+void ExpType::ForAllParametrizations(
+    vec<CharId>& params, uint n,
+    std::function<void(const vec<CharId>&)> callback) const {
+  if (n == num_params_) {
+    callback(params);
+    return;
+  }
+  for (CharId a = 0; a < alph_; a++) {
+    bool valid = true;
+    for (auto p : params_different_[n])
+      if (p < n && params[p] == a) valid = false;
+    for (auto p : params_smaller_than_[n])
+      if (params[p] > a) valid = false;
+    if (!valid) continue;
+    params[n] = a;
+    ForAllParametrizations(params, n + 1, callback);
+  }
+}
+
 void ExpType::PrecomputeUsed(Formula* f) {
   assert(f);
   auto* mapping = dynamic_cast<Mapping*>(f);
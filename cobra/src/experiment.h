@@ -42,6 +42,7 @@ struct EOutcome {
   bool sat;
   int models;
   int fixed;
+  uint models_at_least = 0;  // known lower bound on models
 };
 
 /**
@@ -68,11 +69,25 @@ class Experiment {
   bool IsSat(uint id);
   uint NumOfSat();
   uint NumOfModels(uint id);
+
+  /**
+   * Returns true if outcome 'id' has at least 'k' models. Only counts up
+   * to 'k' (see Solver::NumOfModelsUpTo), unless the number of models is
+   * known or the solver partitions in a single pass; if it is less than
+   * 'k', it becomes known.
+   */
+  bool NumOfModelsAtLeast(uint id, uint k);
   uint TotalNumOfModels();
   uint MaxNumOfModels();
   uint NumOfFixedVars(uint id);
 
   string pretty();
+
+ private:
+  // Computes the number of models (or fixed variables) of all outcomes
+  // at once, see Solver::PartitionByOutcome. Used only if the solver does
+  // it in a single pass; otherwise outcomes are computed as requested.
+  void Partition(bool fixed);
 };
 
 /**
@@ -120,12 +135,24 @@ class ExpType {
 
   void Precompute();
   uint64_t NumberOfParametrizations() const;
+
+  /**
+   * Calls 'callback' on every parametrization that complies with
+   * PARAMS_DISTINCT and PARAMS_SORTED, in lexicographic order.
+   */
+  void ForAllParametrizations(
+      std::function<void(const vec<CharId>&)> callback) const;
   bliss::Graph* CreateGraphForParams(const vec<EvalExp>& history,
                                      const vec<CharId>& params) const;
 
  private:
   // Computes used_maps_ and used_vars_.
   void PrecomputeUsed(Formula* f);
+
+  // Recursive helper for ForAllParametrizations, fills position n.
+  void ForAllParametrizations(
+      vec<CharId>& params, uint n,
+      std::function<void(const vec<CharId>&)> callback) const;
 };
 
 /**
@@ -3,6 +3,7 @@
  * Use of this source code is governed by a BSD-style license that can be
  * found in the LICENSE file.
  */
+#include <cassert>
 #include <cstdio>
 #include <algorithm>
 #include <string>
@@ -11,10 +12,13 @@
 #include <bliss/graph.hh>
 
 #include "./formula.h"
+#include "./compiled-formula.h"
 #include "./common.h"
 
 extern void parse_string(string s);
 
+uint64_t Formula::epoch_ = 0;
+
 Formula* Formula::Parse(string str) {
   parse_string(str);
   assert(m.only_formula());
@@ -59,8 +63,26 @@ vec<VarId> Formula::tseitin_children(CnfSolver& cnf) {
   return vars;
 }
 
+vec<uint> Formula::compile_children(CompiledFormula& cf,
+                                    const vec<CharId>* params) {
+  vec<uint> regs(children_.size(), 0);
+  std::transform(children_.begin(), children_.end(), regs.begin(),
+    [&](Formula* f) {
+      return f->Compile(cf, params);
+    });
+  return regs;
+}
+
+uint Formula::tseitin_todo(bool top, uint polarity) {
+  if (top) return polarity;
+  uint todo = polarity & ~tseitin_done_;
+  tseitin_done_ |= polarity;
+  return todo;
+}
+
 void Formula::ResetTseitinIds() {
   tseitin_var_ = 0;
+  tseitin_done_ = 0;
   for (auto c : children_)
     c->ResetTseitinIds();
 }
@@ -89,74 +111,88 @@ string Mapping::pretty(bool, const vec<CharId>* params) {
  *
  */
 
-bool AndOperator::Satisfied(const vec<bool>& model,
-                            const vec<CharId> params) {
+bool Formula::Satisfied(const vec<bool>& model, const vec<CharId>& params) {
+  epoch_++;
+  return child_satisfied(this, model, params);
+}
+
+bool Formula::child_satisfied(Formula* child, const vec<bool>& model,
+                              const vec<CharId>& params) {
+  if (child->visited_ != epoch_) {
+    child->visited_ = epoch_;
+    child->satisfied_ = child->_Satisfied(model, params);
+  }
+  return child->satisfied_;
+}
+
+bool AndOperator::_Satisfied(const vec<bool>& model,
+                             const vec<CharId>& params) {
   for (auto c : children_) {
-    if (!c->Satisfied(model, params)) return false;
+    if (!child_satisfied(c, model, params)) return false;
   }
   return true;
 }
 
-bool OrOperator::Satisfied(const vec<bool>& model,
-                           const vec<CharId> params) {
+bool OrOperator::_Satisfied(const vec<bool>& model,
+                            const vec<CharId>& params) {
   for (auto c : children_) {
-    if (c->Satisfied(model, params)) return true;
+    if (child_satisfied(c, model, params)) return true;
   }
   return false;
 }
 
-bool AtLeastOperator::Satisfied(const vec<bool>& model,
-                                const vec<CharId> params) {
+bool AtLeastOperator::_Satisfied(const vec<bool>& model,
+                                 const vec<CharId>& params) {
   uint sat = 0;
   for (auto c : children_) {
-    sat += c->Satisfied(model, params);
+    sat += child_satisfied(c, model, params);
     if (sat >= value_) return true;
   }
   return false;
 }
 
-bool AtMostOperator::Satisfied(const vec<bool>& model,
-                               const vec<CharId> params) {
+bool AtMostOperator::_Satisfied(const vec<bool>& model,
+                                const vec<CharId>& params) {
   uint sat = 0;
   for (auto c : children_) {
-    sat += c->Satisfied(model, params);
+    sat += child_satisfied(c, model, params);
   }
   return sat <= value_;
 }
 
-bool ExactlyOperator::Satisfied(const vec<bool>& model,
-                                const vec<CharId> params) {
+bool ExactlyOperator::_Satisfied(const vec<bool>& model,
+                                 const vec<CharId>& params) {
   uint sat = 0;
   for (auto c : children_) {
-    sat += c->Satisfied(model, params);
+    sat += child_satisfied(c, model, params);
   }
   return sat == value_;
 }
 
-bool EquivalenceOperator::Satisfied(const vec<bool>& model,
-                                    const vec<CharId> params) {
-  return children_[0]->Satisfied(model, params) ==
-         children_[1]->Satisfied(model, params);
+bool EquivalenceOperator::_Satisfied(const vec<bool>& model,
+                                     const vec<CharId>& params) {
+  return child_satisfied(children_[0], model, params) ==
+         child_satisfied(children_[1], model, params);
 }
 
-bool ImpliesOperator::Satisfied(const vec<bool>& model,
-                                const vec<CharId> params) {
-  return !children_[0]->Satisfied(model, params) ||
-          children_[1]->Satisfied(model, params);
+bool ImpliesOperator::_Satisfied(const vec<bool>& model,
+                                 const vec<CharId>& params) {
+  return !child_satisfied(children_[0], model, params) ||
+          child_satisfied(children_[1], model, params);
 }
 
-bool NotOperator::Satisfied(const vec<bool>& model,
-                            const vec<CharId> params) {
-  return !children_[0]->Satisfied(model, params);
+bool NotOperator::_Satisfied(const vec<bool>& model,
+                             const vec<CharId>& params) {
+  return !child_satisfied(children_[0], model, params);
 }
 
-bool Mapping::Satisfied(const vec<bool>& model,
-                        const vec<CharId> params) {
+bool Mapping::_Satisfied(const vec<bool>& model,
+                         const vec<CharId>& params) {
   return model[getValue(params)];
 }
 
-bool Variable::Satisfied(const vec<bool>& model,
-                         const vec<CharId>) {
+bool Variable::_Satisfied(const vec<bool>& model,
+                          const vec<CharId>&) {
   assert((unsigned)id_ < model.size());
   return model[id_];
 }
@@ -165,13 +201,26 @@ bool Variable::Satisfied(const vec<bool>& model,
  *
  */
 
-void AndOperator::PropagateFixed(const vec<VarId>& fixed,
-                                 const vec<CharId>* params) {
+void Formula::PropagateFixed(const vec<VarId>& fixed,
+                             const vec<CharId>* params) {
+  epoch_++;
+  child_propagate(this, fixed, params);
+}
+
+void Formula::child_propagate(Formula* child, const vec<VarId>& fixed,
+                              const vec<CharId>* params) {
+  if (child->visited_ == epoch_) return;
+  child->visited_ = epoch_;
+  child->_PropagateFixed(fixed, params);
+}
+
+void AndOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                  const vec<CharId>* params) {
   fixed_ = false;
   bool fixed_all = true;
   non_fixed_childs_ = children_.size();
   for (auto c : children_) {
-    c->PropagateFixed(fixed, params);
+    child_propagate(c, fixed, params);
     if (c->fixed() == true && c->fixed_value()== false) {
       fixed_ = true;
       fixed_value_ = false;
@@ -186,13 +235,13 @@ void AndOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void OrOperator::PropagateFixed(const vec<VarId>& fixed,
-                                const vec<CharId>* params) {
+void OrOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                 const vec<CharId>* params) {
   fixed_ = false;
   bool fixed_all = true;
   non_fixed_childs_ = children_.size();
   for (auto c : children_) {
-    c->PropagateFixed(fixed, params);
+    child_propagate(c, fixed, params);
     if (c->fixed() == true && c->fixed_value() == true) {
       fixed_ = true;
       fixed_value_ = true;
@@ -207,11 +256,11 @@ void OrOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void AtLeastOperator::PropagateFixed(const vec<VarId>& fixed,
-                                     const vec<CharId>* params) {
+void AtLeastOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                      const vec<CharId>* params) {
   uint t = 0, f = 0;
   for (auto c : children_) {
-    c->PropagateFixed(fixed, params);
+    child_propagate(c, fixed, params);
     if (c->fixed() == true) {
       if (c->fixed_value())
         t++;
@@ -231,11 +280,11 @@ void AtLeastOperator::PropagateFixed(const vec<VarId>& fixed,
 }
 
 
-void AtMostOperator::PropagateFixed(const vec<VarId>& fixed,
-                                    const vec<CharId>* params) {
+void AtMostOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                     const vec<CharId>* params) {
   uint t = 0, f = 0;
   for (auto c : children_) {
-    c->PropagateFixed(fixed, params);
+    child_propagate(c, fixed, params);
     if (c->fixed() == true) {
       if (c->fixed_value())
         t++;
@@ -254,11 +303,11 @@ void AtMostOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void ExactlyOperator::PropagateFixed(const vec<VarId>& fixed,
-                                     const vec<CharId>* params) {
+void ExactlyOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                      const vec<CharId>* params) {
   uint t = 0, f = 0;
   for (auto c : children_) {
-    c->PropagateFixed(fixed, params);
+    child_propagate(c, fixed, params);
     if (c->fixed() == true) {
       if (c->fixed_value())
         t++;
@@ -277,11 +326,11 @@ void ExactlyOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void EquivalenceOperator::PropagateFixed(const vec<VarId>& fixed,
-                                         const vec<CharId>* params) {
+void EquivalenceOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                          const vec<CharId>* params) {
   fixed_ = false;
-  children_[0]->PropagateFixed(fixed, params);
-  children_[1]->PropagateFixed(fixed, params);
+  child_propagate(children_[0], fixed, params);
+  child_propagate(children_[1], fixed, params);
   if (children_[0]->fixed() && children_[1]->fixed()) {
     fixed_ = true;
     fixed_value_ = (children_[0]->fixed_value() ==
@@ -289,11 +338,11 @@ void EquivalenceOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void ImpliesOperator::PropagateFixed(const vec<VarId>& fixed,
-                                     const vec<CharId>* params) {
+void ImpliesOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                      const vec<CharId>* params) {
   fixed_ = false;
-  children_[0]->PropagateFixed(fixed, params);
-  children_[1]->PropagateFixed(fixed, params);
+  child_propagate(children_[0], fixed, params);
+  child_propagate(children_[1], fixed, params);
   if (children_[0]->fixed() && children_[0]->fixed_value()== false) {
     // false -> ?
     fixed_ = true;
@@ -311,16 +360,16 @@ void ImpliesOperator::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void NotOperator::PropagateFixed(const vec<VarId>& fixed,
-                                 const vec<CharId>* params) {
+void NotOperator::_PropagateFixed(const vec<VarId>& fixed,
+                                  const vec<CharId>* params) {
   fixed_ = false;
-  children_[0]->PropagateFixed(fixed, params);
+  child_propagate(children_[0], fixed, params);
   fixed_ = children_[0]->fixed();
   fixed_value_ = !children_[0]->fixed_value();
 }
 
-void Mapping::PropagateFixed(const vec<VarId>& fixed,
-                             const vec<CharId>* params) {
+void Mapping::_PropagateFixed(const vec<VarId>& fixed,
+                              const vec<CharId>* params) {
   fixed_ = false;
   assert(params);
   if (std::count(fixed.begin(), fixed.end(), getValue(*params))) {
@@ -332,8 +381,8 @@ void Mapping::PropagateFixed(const vec<VarId>& fixed,
   }
 }
 
-void Variable::PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>*) {
+void Variable::_PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>*) {
   fixed_ = false;
   if (std::count(fixed.begin(), fixed.end(), id_)) {
     fixed_ = true;
@@ -348,37 +397,53 @@ void Variable::PropagateFixed(const vec<VarId>& fixed,
  * Tseitin transformation.
  */
 
+// Polarity of a node under a negation.
+uint FlipPolarity(uint polarity) {
+  return ((polarity & polarity::kPositive) ? polarity::kNegative : 0) |
+         ((polarity & polarity::kNegative) ? polarity::kPositive : 0);
+}
+
 void TseitinAnd(VarId thisVar, CnfSolver& cnf,
                 const vec<VarId>& list, uint limit,
-                bool negate = false) {
+                bool negate, uint polarity) {
   int neg = negate ? -1 : 1;
   // X <-> AND(A1, A2, ..)
   // 1. (X | !A1 | !A2 | ...)
-  vec<VarId> first;
-  for (uint i = 0; i < limit; i++) {
-    first.push_back(neg * -list[i]);
+  if (polarity & polarity::kNegative) {
+    vec<VarId> first;
+    for (uint i = 0; i < limit; i++) {
+      first.push_back(neg * -list[i]);
+    }
+    first.push_back(thisVar);
+    cnf.AddClause(first);
   }
-  first.push_back(thisVar);
-  cnf.AddClause(first);
   // 2. (A1 | !X) & (A2 | !X) & ...
-  for (uint i = 0; i < limit; i++) {
-    cnf.AddClause({ -thisVar, neg * list[i] });
+  if (polarity & polarity::kPositive) {
+    for (uint i = 0; i < limit; i++) {
+      cnf.AddClause({ -thisVar, neg * list[i] });
+    }
   }
 }
 
-void AndOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
+void AndOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                        uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
   // if on top level, all childs must be true - just recurse down
   if (!top) {
     TseitinAnd(tseitin_var(cnf), cnf,
-               tseitin_children(cnf), children_.size());
+               tseitin_children(cnf), children_.size(), false, todo);
   }
   // recurse down
   for (auto& f : children_) {
-    f->TseitinTransformation(cnf, top);
+    f->TseitinTransformation(cnf, top, todo);
   }
 }
 
-void OrOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
+void OrOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                       uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
   vec<VarId> first;
   for (auto& f : children_) {
     first.push_back(f->tseitin_var(cnf));
@@ -388,34 +453,44 @@ void OrOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
     // X <-> OR(A1, A2, ..)
     // (!X | A1 | A2 | ...) & (!A1 | X) & (!A2 | X) & ...
     auto thisVar = tseitin_var(cnf);
-    first.push_back(-thisVar);
-    cnf.AddClause(first);
-    for (auto& f : children_) {
-      cnf.AddClause({ thisVar, -f->tseitin_var(cnf) });
+    if (todo & polarity::kPositive) {
+      first.push_back(-thisVar);
+      cnf.AddClause(first);
+    }
+    if (todo & polarity::kNegative) {
+      for (auto& f : children_) {
+        cnf.AddClause({ thisVar, -f->tseitin_var(cnf) });
+      }
     }
   } else {
     cnf.AddClause(first);
   }
   // recurse down
   for (auto& f : children_) {
-    f->TseitinTransformation(cnf, false);
+    f->TseitinTransformation(cnf, false, todo);
   }
 }
 
-void NotOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
+void NotOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                        uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
   // X <-> (!Y)
   // (!X | !Y) & (X | Y)
   auto thisVar = tseitin_var(cnf);
   auto childVar = children_[0]->tseitin_var(cnf);
   if (top) cnf.AddClause({ thisVar });
   if (!this->isLiteral()) {
-    cnf.AddClause({ -thisVar, -childVar });
-    cnf.AddClause({ thisVar, childVar });
-    children_[0]->TseitinTransformation(cnf, false);
+    if (todo & polarity::kPositive) cnf.AddClause({ -thisVar, -childVar });
+    if (todo & polarity::kNegative) cnf.AddClause({ thisVar, childVar });
+    children_[0]->TseitinTransformation(cnf, false, FlipPolarity(todo));
   }
 }
 
-void ImpliesOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
+void ImpliesOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                            uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
   auto thisVar = tseitin_var(cnf);
   auto leftVar = children_[0]->tseitin_var(cnf);
   auto rightVar = children_[1]->tseitin_var(cnf);
@@ -424,15 +499,22 @@ void ImpliesOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
   } else {
     // X <-> (L -> R)
     // (!X | !L | R) & (L | X) & (!R | X)
-    cnf.AddClause({ -thisVar, -leftVar, rightVar });
-    cnf.AddClause({ leftVar, thisVar });
-    cnf.AddClause({ -rightVar, thisVar });
+    if (todo & polarity::kPositive) {
+      cnf.AddClause({ -thisVar, -leftVar, rightVar });
+    }
+    if (todo & polarity::kNegative) {
+      cnf.AddClause({ leftVar, thisVar });
+      cnf.AddClause({ -rightVar, thisVar });
+    }
   }
-  children_[0]->TseitinTransformation(cnf, false);
-  children_[1]->TseitinTransformation(cnf, false);
+  children_[0]->TseitinTransformation(cnf, false, FlipPolarity(todo));
+  children_[1]->TseitinTransformation(cnf, false, todo);
 }
 
-void EquivalenceOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
+void EquivalenceOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                                uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
   auto thisVar = tseitin_var(cnf);
   auto leftVar = children_[0]->tseitin_var(cnf);
   auto rightVar = children_[1]->tseitin_var(cnf);
@@ -442,92 +524,328 @@ void EquivalenceOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
   } else {
     // X <-> (L <-> R)
     // (X | L | R) & (!X | !L | R) & (!X | L | !R) & (X | !L | !R)
-    cnf.AddClause({ thisVar, leftVar, rightVar });
-    cnf.AddClause({ -thisVar, -leftVar, rightVar });
-    cnf.AddClause({ -thisVar, leftVar, -rightVar });
-    cnf.AddClause({ thisVar, -leftVar, -rightVar });
+    if (todo & polarity::kPositive) {
+      cnf.AddClause({ -thisVar, -leftVar, rightVar });
+      cnf.AddClause({ -thisVar, leftVar, -rightVar });
+    }
+    if (todo & polarity::kNegative) {
+      cnf.AddClause({ thisVar, leftVar, rightVar });
+      cnf.AddClause({ thisVar, -leftVar, -rightVar });
+    }
   }
-  children_[0]->TseitinTransformation(cnf, false);
-  children_[1]->TseitinTransformation(cnf, false);
+  // both sides occur in both polarities
+  children_[0]->TseitinTransformation(cnf, false, polarity::kBoth);
+  children_[1]->TseitinTransformation(cnf, false, polarity::kBoth);
 }
 
-void TseitinNumerical(VarId thisVar, CnfSolver& cnf,
-                      bool at_least, bool at_most, uint value,
-                      const vec<VarId>& children) {
+namespace {
+  // Largest n for which the pairwise encoding is chosen automatically.
+  const uint kPairwiseLimit = 8;
+  // Smallest n * k for which the totalizer is chosen automatically.
+  const uint kTotalizerLimit = 24;
+}  // namespace
+
+void TseitinSequential(VarId thisVar, CnfSolver& cnf,
+                       bool at_least, bool at_most, uint value,
+                       const vec<VarId>& children, uint polarity) {
+  // vars[m][l] <-> at least (resp. at most, exactly) l of the first m
+  // children are true; all of them have the polarity of X
   auto n = children.size();
   vec<vec<VarId>> vars(n + 1, vec<VarId>(value + 1, 0));
   vars[n][value] = thisVar;
   for (uint m = n; m > 0; m--) {
-    if (m <= value && vars[m][m] != 0 && at_least) {
-      assert(vars[m][m] != 0);
-      TseitinAnd(vars[m][m], cnf, children, m);  // all others are true
+    if (m <= value && vars[m][m] != 0) {
+      if (at_least) {
+        TseitinAnd(vars[m][m], cnf, children, m, false, polarity);
+      } else {
+        cnf.AddClause({ vars[m][m] });  // at most m of m always holds
+      }
     }
     for (uint l = 1; l <= value && l < m; l++) {
       if (vars[m][l] == 0) continue;
       if (vars[m-1][l] == 0) vars[m-1][l] = cnf.NewVarId();
       if (vars[m-1][l-1] == 0) vars[m-1][l-1] = cnf.NewVarId();
       // vars[m][l] <->
-      // (children[m] & vars[m-1][l]) | (!children[m] & vars[m-1][l-1])
-      cnf.AddClause({ vars[m][l], -vars[m-1][l], children[m-1] });
-      cnf.AddClause({ -vars[m][l], vars[m-1][l], children[m-1] });
-      cnf.AddClause({ vars[m][l], -vars[m-1][l-1], -children[m-1] });
-      cnf.AddClause({ -vars[m][l], vars[m-1][l-1], -children[m-1] });
+      // (children[m-1] & vars[m-1][l-1]) | (!children[m-1] & vars[m-1][l])
+      if (polarity & polarity::kNegative) {
+        cnf.AddClause({ vars[m][l], -vars[m-1][l], children[m-1] });
+        cnf.AddClause({ vars[m][l], -vars[m-1][l-1], -children[m-1] });
+      }
+      if (polarity & polarity::kPositive) {
+        cnf.AddClause({ -vars[m][l], vars[m-1][l], children[m-1] });
+        cnf.AddClause({ -vars[m][l], vars[m-1][l-1], -children[m-1] });
+      }
     }
-    if (vars[m][0] != 0 && at_most) {
-      TseitinAnd(vars[m][0], cnf, children, m, true);  // all others are false
+    if (vars[m][0] != 0) {
+      if (at_most) {
+        TseitinAnd(vars[m][0], cnf, children, m, true, polarity);
+      } else {
+        cnf.AddClause({ vars[m][0] });  // at least 0 of m always holds
+      }
     }
   }
 }
 
-void ExactlyOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
-  auto thisVar = tseitin_var(cnf);
+void TseitinPairwise(VarId thisVar, CnfSolver& cnf,
+                     bool at_least, bool at_most,
+                     const vec<VarId>& children, uint polarity) {
+  auto n = children.size();
+  if (polarity & polarity::kPositive) {
+    // X -> (A1 | A2 | ...)
+    if (at_least) {
+      vec<VarId> clause(children);
+      clause.push_back(-thisVar);
+      cnf.AddClause(clause);
+    }
+    // X -> (!Ai | !Aj) for all i < j
+    if (at_most) {
+      for (uint i = 0; i < n; i++)
+        for (uint j = i + 1; j < n; j++)
+          cnf.AddClause({ -thisVar, -children[i], -children[j] });
+    }
+  }
+  if (polarity & polarity::kNegative) {
+    if (!at_most) {
+      // Ai -> X
+      for (auto c : children) cnf.AddClause({ thisVar, -c });
+    } else {
+      // (Ai & !Aj for all j != i) -> X
+      for (uint i = 0; i < n; i++) {
+        vec<VarId> clause(children);
+        clause[i] = -children[i];
+        clause.push_back(thisVar);
+        cnf.AddClause(clause);
+      }
+      // (!A1 & !A2 & ...) -> X
+      if (!at_least) {
+        vec<VarId> clause(children);
+        clause.push_back(thisVar);
+        cnf.AddClause(clause);
+      }
+    }
+  }
+}
+
+/**
+ * Unary counter of children[from .. to - 1]: the i-th returned variable
+ * stands for "at least i + 1 of them are true", for i + 1 <= limit.
+ * 'up' adds the implications from the children to the counter, 'down'
+ * the ones from the counter to the children.
+ */
+vec<VarId> TseitinTotalizer(CnfSolver& cnf, const vec<VarId>& children,
+                            uint from, uint to, uint limit,
+                            bool up, bool down) {
+  if (to - from == 1) return { children[from] };
+  uint mid = (from + to) / 2;
+  auto a = TseitinTotalizer(cnf, children, from, mid, limit, up, down);
+  auto b = TseitinTotalizer(cnf, children, mid, to, limit, up, down);
+  uint size = std::min(to - from, limit);
+  vec<VarId> out(size);
+  for (auto& x : out) x = cnf.NewVarId();
+  for (uint i = 0; i <= a.size(); i++) {
+    for (uint j = 0; j <= b.size() && i + j <= size; j++) {
+      // at least i in a & at least j in b -> at least i + j
+      if (up && i + j > 0) {
+        vec<VarId> clause = { out[i + j - 1] };
+        if (i > 0) clause.push_back(-a[i - 1]);
+        if (j > 0) clause.push_back(-b[j - 1]);
+        cnf.AddClause(clause);
+      }
+      // at most i in a & at most j in b -> at most i + j
+      if (down && i + j < size) {
+        vec<VarId> clause = { -out[i + j] };
+        if (i < a.size()) clause.push_back(a[i]);
+        if (j < b.size()) clause.push_back(b[j]);
+        cnf.AddClause(clause);
+      }
+    }
+  }
+  return out;
+}
+
+void TseitinTotalizer(VarId thisVar, CnfSolver& cnf,
+                      bool at_least, bool at_most, uint value,
+                      const vec<VarId>& children, uint polarity) {
+  // X <-> (at least 'value' are true) & !(at least 'value' + 1 are true)
+  auto n = children.size();
+  bool pos = polarity & polarity::kPositive;
+  bool neg = polarity & polarity::kNegative;
+  bool up = (at_least && neg) || (at_most && pos);
+  bool down = (at_least && pos) || (at_most && neg);
+  auto count = TseitinTotalizer(cnf, children, 0, n,
+                                at_most ? value + 1 : value, up, down);
+  VarId lower = (at_least && value > 0) ? count[value - 1] : 0;
+  VarId upper = (at_most && value < n) ? count[value] : 0;
+  if (pos) {
+    if (lower) cnf.AddClause({ -thisVar, lower });
+    if (upper) cnf.AddClause({ -thisVar, -upper });
+  }
+  if (neg) {
+    vec<VarId> clause = { thisVar };
+    if (lower) clause.push_back(-lower);
+    if (upper) clause.push_back(upper);
+    cnf.AddClause(clause);
+  }
+}
+
+void TseitinNumerical(VarId thisVar, CnfSolver& cnf,
+                      bool at_least, bool at_most, uint value,
+                      const vec<VarId>& children, uint polarity) {
+  auto n = children.size();
+  assert(value <= n);
+  // bounds that always hold
+  if ((!at_least || value == 0) && (!at_most || value >= n)) {
+    cnf.AddClause({ thisVar });
+    return;
+  }
+
+  auto encoding = cnf.cardinality_encoding();
+  if (encoding == cardinality::kPairwise && value != 1) {
+    encoding = cardinality::kAuto;
+  }
+  if (encoding == cardinality::kAuto || encoding == cardinality::kNative) {
+    if (value == 1 && n <= kPairwiseLimit) {
+      encoding = cardinality::kPairwise;
+    } else if (n * value >= kTotalizerLimit) {
+      encoding = cardinality::kTotalizer;
+    } else {
+      encoding = cardinality::kSequential;
+    }
+  }
+  switch (encoding) {
+    case cardinality::kPairwise:
+      TseitinPairwise(thisVar, cnf, at_least, at_most, children, polarity);
+      break;
+    case cardinality::kTotalizer:
+      TseitinTotalizer(thisVar, cnf, at_least, at_most, value, children,
+                       polarity);
+      break;
+    default:
+      TseitinSequential(thisVar, cnf, at_least, at_most, value, children,
+                        polarity);
+  }
+}
+
+void TseitinCardinality(VarId thisVar, CnfSolver& cnf, bool top,
+                        bool at_least, bool at_most, uint value,
+                        const vec<VarId>& children, uint polarity) {
+  // the backend may propagate a top-level constraint itself; the clauses
+  // are then needed for model counting only
+  bool native = top && cnf.BeginCardinality(children,
+                                            at_least ? value : 0,
+                                            at_most ? value : children.size());
   if (top) cnf.AddClause({ thisVar });
-  TseitinNumerical(thisVar, cnf,
-                   true, true, value_,
-                   tseitin_children(cnf));
-  // recurse down
+  TseitinNumerical(thisVar, cnf, at_least, at_most, value, children,
+                   polarity);
+  if (native) cnf.EndCardinality();
+}
+
+void ExactlyOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                            uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
+  TseitinCardinality(tseitin_var(cnf), cnf, top,
+                     true, true, value_,
+                     tseitin_children(cnf), todo);
+  // recurse down; the children are not monotone in X
   for (auto& f : children_) {
-    f->TseitinTransformation(cnf, false);
+    f->TseitinTransformation(cnf, false, polarity::kBoth);
   }
 }
 
-void AtLeastOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
-  auto thisVar = tseitin_var(cnf);
-  if (top) cnf.AddClause({ thisVar });
-  TseitinNumerical(thisVar, cnf,
-                   true, false, value_,
-                   tseitin_children(cnf));
+void AtLeastOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                            uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
+  TseitinCardinality(tseitin_var(cnf), cnf, top,
+                     true, false, value_,
+                     tseitin_children(cnf), todo);
   // recurse down
   for (auto& f : children_) {
-    f->TseitinTransformation(cnf, false);
+    f->TseitinTransformation(cnf, false, todo);
   }
 }
 
-void AtMostOperator::TseitinTransformation(CnfSolver& cnf, bool top) {
-  auto thisVar = tseitin_var(cnf);
-  if (top) cnf.AddClause({ thisVar });
-  TseitinNumerical(thisVar, cnf,
-                   false, true, value_,
-                   tseitin_children(cnf));
+void AtMostOperator::TseitinTransformation(CnfSolver& cnf, bool top,
+                                           uint polarity) {
+  auto todo = tseitin_todo(top, polarity);
+  if (!todo) return;
+  TseitinCardinality(tseitin_var(cnf), cnf, top,
+                     false, true, value_,
+                     tseitin_children(cnf), todo);
   // recurse down
   for (auto& f : children_) {
-    f->TseitinTransformation(cnf, false);
+    f->TseitinTransformation(cnf, false, FlipPolarity(todo));
   }
 }
 
-void Mapping::TseitinTransformation(CnfSolver& cnf, bool top) {
+void Mapping::TseitinTransformation(CnfSolver& cnf, bool top, uint) {
   if (top) {
     assert(cnf.build_for_params());
     cnf.AddClause({ getValue(*cnf.build_for_params()) });
   }
 }
 
-void Variable::TseitinTransformation(CnfSolver& cnf, bool top) {
+void Variable::TseitinTransformation(CnfSolver& cnf, bool top, uint) {
   if (top) {
     cnf.AddClause({ id_ });
   }
 }
 
+/******************************************************************************
+ * Compilation to bit-parallel evaluation.
+ */
+
+uint AndOperator::Compile(CompiledFormula& cf, const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kAnd, 0, compile_children(cf, params));
+}
+
+uint OrOperator::Compile(CompiledFormula& cf, const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kOr, 0, compile_children(cf, params));
+}
+
+uint AtLeastOperator::Compile(CompiledFormula& cf,
+                              const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kAtLeast, value_,
+                compile_children(cf, params));
+}
+
+uint AtMostOperator::Compile(CompiledFormula& cf,
+                             const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kAtMost, value_,
+                compile_children(cf, params));
+}
+
+uint ExactlyOperator::Compile(CompiledFormula& cf,
+                              const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kExactly, value_,
+                compile_children(cf, params));
+}
+
+uint EquivalenceOperator::Compile(CompiledFormula& cf,
+                                  const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kEquivalence, 0,
+                compile_children(cf, params));
+}
+
+uint ImpliesOperator::Compile(CompiledFormula& cf,
+                              const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kImplies, 0, compile_children(cf, params));
+}
+
+uint NotOperator::Compile(CompiledFormula& cf, const vec<CharId>* params) {
+  return cf.Add(CompiledFormula::kNot, 0, compile_children(cf, params));
+}
+
+uint Mapping::Compile(CompiledFormula& cf, const vec<CharId>* params) {
+  assert(params);
+  return cf.Add(CompiledFormula::kVariable, getValue(*params), {});
+}
+
+uint Variable::Compile(CompiledFormula& cf, const vec<CharId>*) {
+  return cf.Add(CompiledFormula::kVariable, id_, {});
+}
+
 /*
  * Add a formula tree to the symmetry graph.
  */
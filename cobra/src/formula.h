@@ -23,12 +23,14 @@ class OrOperator;
 class AndOperator;
 class NotOperator;
 class CnfSolver;
+class CompiledFormula;
 
 extern Parser m;
 
 /**
  * Base class for representation of a parametrized propositional formula
- * as a tree. Derived classes are:
+ * as a tree, or rather a DAG: immutable nodes are shared by all parents
+ * (see Parser::get). Derived classes are:
  *  - Variable - represents a propositional variable; has no childs.
  *  - Mapping - defined mapping applied on a parameter, e.g. f($1); no childs.
  *  - NotOperator - negation of any other formula
@@ -42,13 +44,51 @@ extern Parser m;
  *    - ExactlyOperator - exactly k of n formulas must be true
  */
 
+/**
+ * Polarities of a node in the Tseitin transformation, as a bit mask.
+ * A node that occurs only positively needs only the clauses X -> F, a node
+ * that occurs only negatively needs only F -> X (Plaisted-Greenbaum).
+ */
+namespace polarity {
+  const uint kPositive = 1;
+  const uint kNegative = 2;
+  const uint kBoth = kPositive | kNegative;
+}  // namespace polarity
+
+/**
+ * Encodings of the cardinality operators (AtLeast-k, AtMost-k, Exactly-k
+ * of n subformulas) to clauses:
+ *  - kSequential - grid of nodes "l of the first m subformulas", O(n k)
+ *  - kTotalizer - tree of unary counters of the subtrees, O(n k) variables
+ *    in a tree of logarithmic depth
+ *  - kPairwise - for k = 1 only, no auxiliary variables but O(n^2) clauses
+ *  - kAuto - one of the above chosen by n and k
+ *  - kNative - as kAuto, but the cardinality constraints on the top level
+ *    of the base constraint are propagated by the SAT solver itself, if it
+ *    can (see CnfSolver::BeginCardinality)
+ */
+namespace cardinality {
+  const uint kAuto = 0;
+  const uint kSequential = 1;
+  const uint kTotalizer = 2;
+  const uint kPairwise = 3;
+  const uint kNative = 4;
+}  // namespace cardinality
+
 class Formula {
  protected:
   VarId tseitin_var_ = 0;
+  uint tseitin_done_ = 0;  // polarities whose clauses were already added
   bool fixed_;
   bool fixed_value_;
   vec<Formula*> children_;
 
+  // Every call of Satisfied and PropagateFixed gets a new epoch; visited_
+  // holds the epoch in which the node was last visited.
+  static uint64_t epoch_;
+  uint64_t visited_ = 0;
+  bool satisfied_;
+
  public:
   virtual ~Formula() { }
 
@@ -64,6 +104,12 @@ class Formula {
 
   virtual uint type_id() = 0;
 
+  /**
+   * Returns true if the node does not change after construction, so that
+   * it can be shared by structurally equal subformulas.
+   */
+  virtual bool immutable() { return true; }
+
   bool fixed() const { return fixed_; }
   bool fixed_value() const { return fixed_value_; }
 
@@ -101,9 +147,18 @@ class Formula {
    * Tseitin transformation - used for conversion to CNF.
    * Capures the relationsships between this node and its children as clauses
    * that are added to the vector 'clauses'. Recursively calls the same
-   * on all children.
+   * on all children. Only the implications needed for the given polarity
+   * of the node are added; the top level has positive polarity.
    */
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top) = 0;
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity) = 0;
+
+  /**
+   * Compiles the subtree under a given parametrization to a flat list
+   * of bit-parallel instructions (see CompiledFormula). Returns the register
+   * that holds the value of this node.
+   */
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params) = 0;
 
   /**
    * Partially evaluates the formula if values of some variables are fixed.
@@ -111,8 +166,7 @@ class Formula {
    * of fixed variables. The set of fixed variables should be output
    * of GetFixedVars() method of a SAT solver.
    */
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params) = 0;
+  void PropagateFixed(const vec<VarId>& fixed, const vec<CharId>* params);
 
    /**
    * Adds the formula structure to a symmetry graph. The formula is simplified
@@ -146,7 +200,7 @@ class Formula {
   /**
    * Evaluates the formula under a given model.
    */
-  virtual bool Satisfied(const vec<bool>& model, const vec<CharId> params) = 0;
+  bool Satisfied(const vec<bool>& model, const vec<CharId>& params);
 
   /**
    * Parses a formula from a string.
@@ -154,11 +208,38 @@ class Formula {
   static Formula* Parse(string str);
 
  protected:
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params) = 0;
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params) = 0;
+
+  /**
+   * Evaluates (resp. propagates fixed variables to) a child within the
+   * current call of Satisfied (resp. PropagateFixed). A node shared by
+   * several parents is visited only once per call.
+   */
+  bool child_satisfied(Formula* child, const vec<bool>& model,
+                       const vec<CharId>& params);
+  void child_propagate(Formula* child, const vec<VarId>& fixed,
+                       const vec<CharId>* params);
+
+  /**
+   * Returns the polarities among 'polarity' whose defining clauses were not
+   * yet added in the ongoing Tseitin transformation, and marks them as added.
+   * On the top level, no defining clauses are added.
+   */
+  uint tseitin_todo(bool top, uint polarity);
+
   /**
    * Gets vector of results of tseitin_var() called on all children.
    */
   vec<VarId> tseitin_children(CnfSolver& cnf);
 
+  /**
+   * Gets vector of registers of all children compiled to 'cf'.
+   */
+  vec<uint> compile_children(CompiledFormula& cf, const vec<CharId>* params);
+
   /**
    * Helper function for pretty.
    * Calls pretty on childs and joins results with 'sep'.
@@ -209,6 +290,7 @@ class AndOperator: public NaryOperator {
       : NaryOperator(list) { }
 
   virtual uint type_id() { return vertex_type::kAndId; }
+  virtual bool immutable() { return false; }  // extended by OnAssocOp
   virtual string name() {
     return "AndOperator";
   }
@@ -217,12 +299,14 @@ class AndOperator: public NaryOperator {
     return pretty_join(utf8 ? " ∧ " : " & ", utf8, params);
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
   virtual void AddToGraph(bliss::Graph& g,
                           const vec<CharId>* params,
                           int parent = -1);
@@ -243,6 +327,7 @@ class OrOperator: public NaryOperator {
      : NaryOperator(list) {}
 
   virtual uint type_id() { return vertex_type::kOrId; }
+  virtual bool immutable() { return false; }  // extended by OnAssocOp
   virtual string name() {
     return "OrOperator";
   }
@@ -251,12 +336,14 @@ class OrOperator: public NaryOperator {
     return pretty_join(utf8 ? " ∨ " : " | ", utf8, params);
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
   virtual void AddToGraph(bliss::Graph& g,
                           const vec<CharId>* params,
                           int parent = -1);
@@ -289,12 +376,14 @@ class AtLeastOperator: public NaryOperator {
             pretty_join(", ", utf8, params);
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 };
 
 /**
@@ -324,12 +413,14 @@ class AtMostOperator: public NaryOperator {
              + pretty_join(", ", utf8, params);
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 };
 
 /**
@@ -359,12 +450,14 @@ class ExactlyOperator: public NaryOperator {
              + pretty_join(", ", utf8, params);
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 };
 
 /**
@@ -390,12 +483,14 @@ class EquivalenceOperator: public Formula {
       ")";
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 };
 
 /**
@@ -421,12 +516,14 @@ class ImpliesOperator: public Formula {
       ")";
   }
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 };
 
 /**
@@ -462,12 +559,14 @@ class NotOperator: public Formula {
     return children_[0]->isLiteral();
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
 };
 
 /**
@@ -514,12 +613,14 @@ class Mapping: public Formula {
     return "Mapping " + pretty();
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model,
-                         const vec<CharId> params);
-  virtual void PropagateFixed(const vec<VarId>& fixed,
-                              const vec<CharId>* params);
+  virtual bool _Satisfied(const vec<bool>& model,
+                          const vec<CharId>& params);
+  virtual void _PropagateFixed(const vec<VarId>& fixed,
+                               const vec<CharId>* params);
   virtual void AddToGraph(bliss::Graph& g,
                           const vec<CharId>* params,
                           int parent = -1);
@@ -537,6 +638,7 @@ class Variable: public Formula {
       : ident_(ident) { }
 
   virtual uint type_id() { return vertex_type::kVariableId; }
+  virtual bool immutable() { return false; }  // one node per declaration
 
   VarId id() { return id_; }
   void set_id(VarId value) { id_ = value; }
@@ -559,10 +661,12 @@ class Variable: public Formula {
     return true;
   }
 
-  virtual void TseitinTransformation(CnfSolver& cnf, bool top);
+  virtual void TseitinTransformation(CnfSolver& cnf, bool top,
+                                     uint polarity);
+  virtual uint Compile(CompiledFormula& cf, const vec<CharId>* params);
 
-  virtual bool Satisfied(const vec<bool>& model, const vec<CharId>);
-  virtual void PropagateFixed(const vec<VarId>& fixed, const vec<CharId>*);
+  virtual bool _Satisfied(const vec<bool>& model, const vec<CharId>&);
+  virtual void _PropagateFixed(const vec<VarId>& fixed, const vec<CharId>*);
   virtual void AddToGraph(bliss::Graph& g,
                           const vec<CharId>* params,
                           int parent = -1);
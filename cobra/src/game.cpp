@@ -101,6 +101,37 @@ void Game::Precompute() {
   }
 }
 
+uint64_t Game::Hash() const {
+  // canonical textual description of the game, hashed by 64-bit FNV-1a
+  string s;
+  for (uint id = 1; id < vars_.size(); id++) s += vars_[id]->ident() + ",";
+  s += "\n" + constraint_->pretty(false) + "\n";
+  for (auto& a : alphabet_) s += a + ",";
+  s += "\n";
+  for (auto& mapping : mappings_) {
+    for (auto id : mapping) s += std::to_string(id) + ",";
+    s += "\n";
+  }
+  for (auto e : experiments_) {
+    s += e->name() + " " + std::to_string(e->num_params()) + "\n";
+    for (uint i = 0; i < e->num_params(); i++) {
+      for (auto j : e->params_different_[i]) s += std::to_string(j) + ",";
+      s += ";";
+      for (auto j : e->params_smaller_than_[i]) s += std::to_string(j) + ",";
+      s += "\n";
+    }
+    for (auto& o : e->outcomes()) {
+      s += o.name + (o.final ? " F " : " X ") + o.formula->pretty(false) + "\n";
+    }
+  }
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
 bliss::Graph* Game::CreateGraph() const {
   // Create the graph
   auto g = new bliss::Graph(0);
@@ -70,6 +70,12 @@ class Game {
   string ParamsToStr(const vec<CharId>& params, char sep = ' ') const;
   void Precompute();
 
+  /**
+   * Returns a hash of the whole game specification (variables, constraint,
+   * alphabet, mappings and experiments). Used as a key for on-disk caches.
+   */
+  uint64_t Hash() const;
+
   bliss::Graph* CreateGraph() const;
 };
 
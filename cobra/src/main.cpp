@@ -23,8 +23,10 @@
 #include "./strategy.h"
 #include "./minisolver.h"
 #include "./picosolver.h"
+#include "./portfolio-solver.h"
 #include "./optimal.h"
 #include "./simple-solver.h"
+#include "./bdd-solver.h"
 
 extern "C" int yyparse();
 extern "C" FILE* yyin;
@@ -35,16 +37,62 @@ std::function<uint(Experiment&)> g_makerStg;
 
 Args args;
 
+/**
+ * Gets the encoding of cardinality constraints given on the command line.
+ */
+uint get_cardinality_encoding() {
+  if (args.cardinality == "sequential") return cardinality::kSequential;
+  if (args.cardinality == "totalizer") return cardinality::kTotalizer;
+  if (args.cardinality == "pairwise") return cardinality::kPairwise;
+  if (args.cardinality == "native") return cardinality::kNative;
+  return cardinality::kAuto;
+}
+
+/**
+ * Sets the options given on the command line to a CNF solver.
+ */
+void set_cnf_options(CnfSolver* solver) {
+  solver->SetApproximation(args.approx_epsilon, args.approx_delta);
+  solver->SetCardinalityEncoding(get_cardinality_encoding());
+  solver->SetPreprocessing(args.preprocess);
+}
+
 /**
  * Creates a new SAT solver instance according the specified backend.
  */
 Solver* get_solver(uint var_count, Formula* constraint = nullptr) {
   if (args.backend == "picosat") {
-    return new PicoSolver(var_count, constraint);
+    auto solver = new PicoSolver(var_count);
+    set_cnf_options(solver);
+    if (constraint) solver->AddConstraint(constraint);
+    return solver;
   } else if (args.backend == "minisat") {
-    return new MiniSolver(var_count, constraint);
+    auto solver = new MiniSolver(var_count);
+    set_cnf_options(solver);
+    if (constraint) solver->AddConstraint(constraint);
+    return solver;
+  } else if (args.backend == "portfolio") {
+    auto solver = new PortfolioSolver(var_count, std::max(2u, args.threads));
+    for (auto member : solver->members()) set_cnf_options(member);
+    if (constraint) solver->AddConstraint(constraint);
+    return solver;
+  } else if (args.backend == "bdd") {
+    return new BddSolver(var_count, constraint, &m.game());
   } else if (args.backend == "simple") {
-    return new SimpleSolver(var_count, constraint);
+    auto max_cells = static_cast<uint64_t>(args.outcome_table) << 20;
+    if (!args.cache_dir.empty()) {
+      char name[32];
+      snprintf(name, sizeof(name), "/%016llx.cache",
+               static_cast<unsigned long long>(m.game().Hash()));  // NOLINT
+      auto solver = SimpleSolver::LoadCached(args.cache_dir + name, m.game(),
+                                             max_cells);
+      solver->SetThreads(args.threads);
+      return solver;
+    }
+    auto solver = new SimpleSolver(var_count, constraint);
+    if (max_cells > 0) solver->PrecomputeOutcomes(m.game(), max_cells);
+    solver->SetThreads(args.threads);
+    return solver;
   }
   assert(false);
 }
@@ -59,14 +107,16 @@ void time_overview(clock_t start) {
          Game::bliss_calls, toSeconds(Game::bliss_time));
   auto s1 = PicoSolver::s_stats();
   printf(
-    "PicoSolver (calls/time): sat %i/%.2fs fixed %i/%.2fs models %i/%.2fs\n",
-    s1.sat_calls, toSeconds(s1.sat_time),
+    "PicoSolver (calls/time): sat %i/%.2fs (propagated %i, reused model %i) "
+    "fixed %i/%.2fs models %i/%.2fs\n",
+    s1.sat_calls, toSeconds(s1.sat_time), s1.sat_propagated, s1.sat_reused,
     s1.fixed_calls, toSeconds(s1.fixed_time),
     s1.models_calls, toSeconds(s1.models_time));
   auto s2 = MiniSolver::s_stats();
   printf(
-    "MiniSolver (calls/time): sat %i/%.2fs fixed %i/%.2fs models %i/%.2fs\n",
-    s2.sat_calls, toSeconds(s2.sat_time),
+    "MiniSolver (calls/time): sat %i/%.2fs (propagated %i, reused model %i) "
+    "fixed %i/%.2fs models %i/%.2fs\n",
+    s2.sat_calls, toSeconds(s2.sat_time), s2.sat_propagated, s2.sat_reused,
     s2.fixed_calls, toSeconds(s2.fixed_time),
     s2.models_calls, toSeconds(s2.models_time));
   auto s3 = SimpleSolver::s_stats();
@@ -75,6 +125,19 @@ void time_overview(clock_t start) {
     s3.sat_calls, toSeconds(s3.sat_time),
     s3.fixed_calls, toSeconds(s3.fixed_time),
     s3.models_calls, toSeconds(s3.models_time));
+  auto s4 = BddSolver::s_stats();
+  printf(
+    "BddSolver (calls/time): sat %i/%.2fs fixed %i/%.2fs models %i/%.2fs\n",
+    s4.sat_calls, toSeconds(s4.sat_time),
+    s4.fixed_calls, toSeconds(s4.fixed_time),
+    s4.models_calls, toSeconds(s4.models_time));
+  auto s5 = PortfolioSolver::s_stats();
+  printf(
+    "PortfolioSolver (calls/time): sat %i/%.2fs fixed %i/%.2fs "
+    "models %i/%.2fs\n",
+    s5.sat_calls, toSeconds(s5.sat_time),
+    s5.fixed_calls, toSeconds(s5.fixed_time),
+    s5.models_calls, toSeconds(s5.models_time));
 }
 
 void overview_mode() {
@@ -154,10 +217,12 @@ void simulation_mode() {
   vec<EvalExp> process;
   while (true) {
     ExpGenerator gen(game, *solver, process, args.symmetry_detection);
+    solver->BeginBatch();
     auto options = gen.All();
 
     // Choose and print an experiment
     auto& experiment = options[g_breakerStg(options)];
+    solver->EndBatch();
     printf("%sEXPERIMENT: %s %s %s\n",
            color::semph,
            experiment.type().name().c_str(),
@@ -229,9 +294,11 @@ void analyze(Solver& solver, vec<EvalExp>& history,
              uint depth, uint& max, uint& sum, uint& num) {
   Game& game = m.game();
   ExpGenerator gen(game, solver, history, args.symmetry_detection);
+  solver.BeginBatch();
   auto options = gen.All();
   // printf("TONY: %i %lu\n", depth, options.size());
   auto x = g_breakerStg(options);
+  solver.EndBatch();
   assert(x < options.size());
   auto experiment = options[x];
   for (uint i = 0; i < experiment.type().outcomes().size(); i++) {
@@ -288,7 +355,8 @@ void parse_args(int argc, char* argv[]) {
     "Specifies the mode of operation. Overview mode is default (o).", false,
     "o", &modeConstraint);
 
-  vec<string> backends = { "picosat", "minisat", "simple" };
+  vec<string> backends = { "picosat", "minisat", "simple", "bdd",
+                           "portfolio" };
   ValuesConstraint<string> backendConstraint(backends);
   ValueArg<string> backend_arg(
     "s", "sat-solver",
@@ -324,6 +392,46 @@ void parse_args(int argc, char* argv[]) {
     "", "opt-bound",
     "Sets the upper bound on the number of experiments in the optimal mode",
     false, -1, "double");
+  ValueArg<uint> table_arg(
+    "", "outcome-table",
+    "Precomputes the outcomes of all experiments on all codes, using at most "
+    "the given number of MB (simple solver only). Default: 0 (disabled).",
+    false, 0, "MB");
+  ValueArg<string> cache_arg(
+    "", "cache-dir",
+    "Directory where the code set and the outcome table of a game are "
+    "cached between runs (simple solver only). Default: none.",
+    false, "", "dir");
+  ValueArg<uint> threads_arg(
+    "", "threads",
+    "Number of threads used to filter the codes (simple solver), or the "
+    "number of solvers in the portfolio (portfolio solver, at least 2). "
+    "Default: 1.",
+    false, 1, "number");
+  ValueArg<double> epsilon_arg(
+    "", "approx-epsilon",
+    "Counts models approximately, within a factor of (1 + epsilon) from the "
+    "exact count (minisat and picosat only). Default: 0 (exact counting).",
+    false, 0, "epsilon");
+  ValueArg<double> delta_arg(
+    "", "approx-delta",
+    "Probability that an approximate count is out of the bounds given by "
+    "--approx-epsilon. Default: 0.2.",
+    false, 0.2, "delta");
+  vec<string> encodings = { "auto", "sequential", "totalizer", "pairwise",
+                            "native" };
+  ValuesConstraint<string> cardinality_constr(encodings);
+  ValueArg<string> cardinality_arg(
+    "", "cardinality",
+    "Encoding of AtLeast, AtMost and Exactly to CNF (minisat and picosat "
+    "only). Pairwise applies to the bound 1 only. Native passes cardinality "
+    "constraints of the base constraint to minisat as they are. "
+    "Default: auto.",
+    false, "auto", &cardinality_constr);
+  SwitchArg preprocess_arg(
+    "", "preprocess",
+    "Simplifies the CNF of the game constraint by variable elimination "
+    "before it is used (minisat and picosat only).");
   UnlabeledValueArg<std::string> filename_arg(
     "filename",
     "Input file name.", false,
@@ -331,6 +439,13 @@ void parse_args(int argc, char* argv[]) {
 
   cmd.add(sym_arg);
   cmd.add(optbound_arg);
+  cmd.add(table_arg);
+  cmd.add(cache_arg);
+  cmd.add(threads_arg);
+  cmd.add(epsilon_arg);
+  cmd.add(delta_arg);
+  cmd.add(cardinality_arg);
+  cmd.add(preprocess_arg);
   cmd.add(e_arg);
   cmd.add(o_arg);
   cmd.add(backend_arg);
@@ -345,6 +460,19 @@ void parse_args(int argc, char* argv[]) {
   args.stg_outcome = o_arg.getValue();
   args.symmetry_detection = !sym_arg.getValue();
   args.opt_bound = optbound_arg.getValue();
+  args.outcome_table = table_arg.getValue();
+  args.cache_dir = cache_arg.getValue();
+  args.threads = std::max(1u, threads_arg.getValue());
+  args.approx_epsilon = epsilon_arg.getValue();
+  args.approx_delta = delta_arg.getValue();
+  args.cardinality = cardinality_arg.getValue();
+  args.preprocess = preprocess_arg.getValue();
+  if (args.approx_epsilon < 0 ||
+      (args.approx_epsilon > 0 &&
+       (args.approx_delta <= 0 || args.approx_delta >= 1))) {
+    throw CmdLineParseException("expected epsilon >= 0 and 0 < delta < 1",
+                                "approx-epsilon");
+  }
 }
 
 int main(int argc, char* argv[]) {
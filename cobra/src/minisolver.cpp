@@ -18,10 +18,26 @@
 #include "./common.h"
 
 
+using Minisat::lbool;  // for l_True and l_Undef
+
+namespace {
+  // Number of released variables that triggers a simplification.
+  const uint kSimplifyAfter = 1 << 12;
+  // Propagations between two checks for an interrupt.
+  const int64_t kSlice = 1 << 20;
+  // Frequency of random decisions of a seeded solver.
+  const double kRandomVarFreq = 0.02;
+}  // namespace
+
 SolverStats MiniSolver::stats_ = SolverStats();
 
-MiniSolver::MiniSolver(uint var_count, Formula* constraint) {
+MiniSolver::MiniSolver(uint var_count, Formula* constraint, uint seed) {
   var_count_ = var_count;
+  if (seed > 0) {
+    minisat_.random_seed = seed;
+    minisat_.random_var_freq = kRandomVarFreq;
+    minisat_.rnd_init_act = true;
+  }
   // Reserve id's for original variables.
   for (uint i = 1; i < var_count_; i++) {
     auto x = minisat_.newVar(true, true);
@@ -33,7 +49,7 @@ MiniSolver::MiniSolver(uint var_count, Formula* constraint) {
 //------------------------------------------------------------------------------
 // Adding constraints
 
-void MiniSolver::AddClause(const vec<VarId>& list) {
+void MiniSolver::_AddClause(const vec<VarId>& list) {
   Minisat::vec<Minisat::Lit> v;
   for (int i = 0; i < contexts_.size(); i++)
     v.push(~contexts_[i]);
@@ -42,35 +58,79 @@ void MiniSolver::AddClause(const vec<VarId>& list) {
   minisat_.addClause(v);
 }
 
-void MiniSolver::AddClause(std::initializer_list<VarId> list) {
-  Minisat::vec<Minisat::Lit> v;
-  for (int i = 0; i < contexts_.size(); i++)
-    v.push(~contexts_[i]);
-  for (auto var : list)
+bool MiniSolver::_AddCardinality(const vec<VarId>& lits, uint lower,
+                                 uint upper) {
+  // the propagator needs distinct variables
+  std::set<VarId> vars;
+  for (auto var : lits)
+    if (!vars.insert(abs(var)).second) return false;
+  Minisat::vec<Minisat::Lit> v, neg;
+  for (auto var : lits) {
     v.push(Minisat::mkLit(abs(var) - 1, var > 0));
-  minisat_.addClause(v);
+    neg.push(~v.last());
+  }
+  // at least 'lower' true = at most n - 'lower' false
+  if (upper < lits.size()) minisat_.addAtMost(v, upper);
+  if (lower > 0) minisat_.addAtMost(neg, lits.size() - lower);
+  return true;
 }
 
 //------------------------------------------------------------------------------
 
-void MiniSolver::OpenContext() {
+VarId MiniSolver::_NewVarId() {
+  auto v = minisat_.newVar(true, false);
+  if (!context_vars_.empty()) context_vars_.back().push_back(v);
+  return v + 1;
+}
+
+void MiniSolver::_OpenContext() {
   contexts_.push(Minisat::mkLit(minisat_.newVar(), true));
+  context_vars_.push_back(vec<Minisat::Var>());
 }
 
-void MiniSolver::CloseContext() {
+void MiniSolver::_CloseContext() {
   assert(contexts_.size() > 0);
   auto k = contexts_.last();
   contexts_.pop();
-  minisat_.addClause(~k);
+  // All clauses of the context (and all clauses learnt from them) contain
+  // ~k, so they become satisfied and the variables of the context occur in
+  // no other clause. Satisfied clauses are removed by 'simplify', which also
+  // makes the released variables available to 'newVar'.
+  minisat_.releaseVar(~k);
+  for (auto v : context_vars_.back()) minisat_.releaseVar(Minisat::mkLit(v));
+  released_ += context_vars_.back().size() + 1;
+  context_vars_.pop_back();
+  if (released_ >= kSimplifyAfter) {
+    minisat_.simplify();
+    released_ = 0;
+  }
 }
 
 //------------------------------------------------------------------------------
 // SAT solver stuff
 
+void MiniSolver::GetAssumptions(Minisat::vec<Minisat::Lit>* assumps) const {
+  contexts_.copyTo(*assumps);
+  for (auto var : assumptions())
+    assumps->push(Minisat::mkLit(abs(var) - 1, var > 0));
+}
+
+bool MiniSolver::Solve() {
+  Minisat::vec<Minisat::Lit> assumps;
+  GetAssumptions(&assumps);
+  while (true) {
+    minisat_.setPropBudget(kSlice);
+    auto r = minisat_.solveLimited(assumps);
+    if (r == l_True) ModelFound();
+    if (r != l_Undef) return r == l_True;
+    if (interrupted()) return false;
+  }
+}
+
 bool MiniSolver::_MustBeTrue(VarId id) {
   assert(id > 0);
   contexts_.push(Minisat::mkLit(abs(id) - 1, false));
-  auto r = !minisat_.solve(contexts_);
+  auto r = !Solve();
   contexts_.pop();
   return r;
 }
@@ -78,32 +138,13 @@ bool MiniSolver::_MustBeTrue(VarId id) {
 bool MiniSolver::_MustBeFalse(VarId id) {
   assert(id > 0);
   contexts_.push(Minisat::mkLit(abs(id) - 1, true));
-  auto r = !minisat_.solve(contexts_);
+  auto r = !Solve();
   contexts_.pop();
   return r;
 }
 
-vec<VarId> MiniSolver::_GetFixedVars() {
-  vec<VarId> result;
-  for (uint id = 1; id < var_count_; id++) {
-    if (_MustBeTrue(id)) result.push_back(id);
-    if (_MustBeFalse(id)) result.push_back(-id);
-  }
-  return result;
-}
-
-uint MiniSolver::_GetNumOfFixedVars() {
-  uint r = 0;
-  for (uint id = 1; id < var_count_; id++) {
-    r += _MustBeTrue(id);
-    r += _MustBeFalse(id);
-  }
-  return r;
-}
-
 bool MiniSolver::_Satisfiable() {
-  auto r = minisat_.solve(contexts_);
-  return r;
+  return Solve();
 }
 
 vec<bool> MiniSolver::GetModel() {
@@ -114,32 +155,60 @@ vec<bool> MiniSolver::GetModel() {
   return result;
 }
 
-void MiniSolver::ForAllModels(VarId var, std::function<void()> callback) {
-  assert(var > 0 && (unsigned)var < var_count_);
-  for (auto v : std::initializer_list<Minisat::Lit>(
-        {Minisat::mkLit(var - 1, true), Minisat::mkLit(var - 1, false)})) {
-    contexts_.push(v);
-    if (_Satisfiable()) {
-      if ((unsigned)var == var_count_ - 1) {
-        callback();
-      } else {
-        ForAllModels(var + 1, callback);
-      }
-    }
-    contexts_.pop();
+vec<int> MiniSolver::Implied() {
+  Minisat::vec<Minisat::Lit> assumps, out;
+  GetAssumptions(&assumps);
+  vec<int> implied(var_count_, 0);
+  if (!minisat_.implies(assumps, out)) return implied;
+  for (int i = 0; i < out.size(); i++) {
+    auto id = Minisat::var(out[i]) + 1;
+    if ((unsigned)id < var_count_) implied[id] = Minisat::sign(out[i]) ? 1 : -1;
+  }
+  return implied;
+}
+
+bool MiniSolver::ForAllModels(VarId var, const vec<bool>& model,
+                              const vec<int>* implied, bool stale,
+                              std::function<bool(const vec<bool>&)> callback) {
+  if ((unsigned)var == var_count_) return callback(model);
+  if (interrupted()) return false;
+  vec<int> recomputed;
+  if (stale && (*implied)[var] == 0) {
+    // the decisions since the last propagation may imply the variable
+    recomputed = Implied();
+    implied = &recomputed;
+    stale = false;
   }
+  auto lit = Minisat::mkLit(var - 1, model[var]);
+  contexts_.push(lit);
+  bool go_on = ForAllModels(var + 1, model, implied,
+                            stale || (*implied)[var] == 0, callback);
+  contexts_.pop();
+  if (!go_on || (*implied)[var] != 0) return go_on;
+
+  // the other value needs a new model
+  contexts_.push(~lit);
+  if (Solve()) {
+    go_on = ForAllModels(var + 1, GetModel(), implied, true, callback);
+  }
+  contexts_.pop();
+  return go_on;
 }
 
-uint MiniSolver::_NumOfModels() {
-  uint k = 0;
-  ForAllModels(1, [&]() { k++; });
-  return k;
+void MiniSolver::ForAllModels(
+    std::function<bool(const vec<bool>&)> callback) {
+  if (!Solve()) return;
+  auto implied = Implied();
+  ForAllModels(1, GetModel(), &implied, false, callback);
 }
 
 vec<vec<bool>> MiniSolver::_GenerateModels() {
   vec<vec<bool>> models;
-  ForAllModels(1, [&]() {
-    models.push_back(GetModel());
+  ForAllModels([&](const vec<bool>& model) {
+    models.push_back(model);
+    return true;
   });
+  // in the order of a search that tries true before false
+  std::sort(models.begin(), models.end(), std::greater<vec<bool>>());
   return models;
 }
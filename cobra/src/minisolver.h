@@ -5,6 +5,7 @@
  */
 
 #include <cassert>
+#include <functional>
 #include <vector>
 #include <map>
 #include <set>
@@ -26,35 +27,69 @@ class MiniSolver: public CnfSolver {
   Minisat::Solver minisat_;
   Minisat::vec<Minisat::Lit> contexts_;
 
+  // Variables created in each open context; they are released (and their
+  // clauses removed) when the context is closed.
+  vec<vec<Minisat::Var>> context_vars_;
+  uint released_ = 0;  // released since the last simplification
+
  public:
-  MiniSolver(uint var_count, Formula* constraint = nullptr);
+  /**
+   * A non-zero 'seed' makes the solver randomized: some decisions and the
+   * initial activities of variables are random.
+   */
+  MiniSolver(uint var_count, Formula* constraint = nullptr, uint seed = 0);
   ~MiniSolver() { }
 
   SolverStats& stats() { return stats_; }
   static SolverStats& s_stats() { return stats_; }
 
-  void AddClause(const vec<VarId>& list);
-  void AddClause(std::initializer_list<VarId> list);
-
-  void OpenContext();
-  void CloseContext();
-
-  VarId NewVarId() {
-    return minisat_.newVar(true, false) + 1;
-  }
 
   vec<bool> GetModel();
 
  private:
+  VarId _NewVarId();
+  void _AddClause(const vec<VarId>& list);
+  void _OpenContext();
+  void _CloseContext();
+  bool _AddCardinality(const vec<VarId>& lits, uint lower, uint upper);
+
   bool _MustBeTrue(VarId id);
   bool _MustBeFalse(VarId id);
-  vec<VarId> _GetFixedVars();
-  uint _GetNumOfFixedVars();
   bool _Satisfiable();
-  uint _NumOfModels();
   vec<vec<bool>> _GenerateModels();
 
-  void ForAllModels(VarId var, std::function<void()> callback);
+  /**
+   * Solves the current constraints under the assumptions in 'contexts_'
+   * and those of CnfSolver (see GetAssumptions).
+   * The search runs in slices, so that it can be interrupted.
+   */
+  bool Solve();
+
+  void GetAssumptions(Minisat::vec<Minisat::Lit>* assumps) const;
+
+  /**
+   * Gets the values of the original variables implied by unit propagation
+   * of the assumptions (see Solve): 1 true, -1 false, 0 not implied.
+   */
+  vec<int> Implied();
+
+  /**
+   * Calls 'callback' for every model of the current constraints, projected
+   * onto the original variables, until it returns false. The models are
+   * enumerated by a search over the original variables that reuses every
+   * model found: only the other value of a variable that is not implied by
+   * unit propagation needs a call of the SAT solver.
+   */
+  void ForAllModels(std::function<bool(const vec<bool>&)> callback);
+
+  /**
+   * Enumerates the models that agree with the values of variables 1 ..
+   * var - 1 assumed in 'contexts_'; 'model' is one of them. 'implied' are
+   * the implied values (see Implied) for a part of the assumptions; they
+   * are 'stale' if the other assumptions may imply more.
+   */
+  bool ForAllModels(VarId var, const vec<bool>& model, const vec<int>* implied,
+                    bool stale, std::function<bool(const vec<bool>&)> callback);
 };
 
 #endif  // COBRA_SRC_MINISOLVER_H_
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./model-counter.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <unordered_map>
+#include "./common.h"
+
+namespace {
+  const uint kMaxCacheEntries = 1 << 20;
+
+  // saturated multiplication
+  uint64_t mul(uint64_t a, uint64_t b) {
+    if (a == 0 || b == 0) return 0;
+    if (a > UINT64_MAX / b) return UINT64_MAX;
+    return a * b;
+  }
+
+  // saturated addition
+  uint64_t add(uint64_t a, uint64_t b) {
+    return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+  }
+}  // namespace
+
+ModelCounter::ModelCounter(uint num_vars, uint num_projected)
+    : num_vars_(num_vars),
+      num_projected_(num_projected),
+      occurs_(num_vars),
+      value_(num_vars, 0),
+      parent_(num_vars, 0),
+      stamp_(num_vars, 0),
+      scratch_(num_vars, 0),
+      scratch_stamp_(num_vars, 0) {
+  assert(num_projected <= num_vars);
+}
+
+void ModelCounter::AddClause(const vec<VarId>& clause) {
+  vec<VarId> c(clause);
+  std::sort(c.begin(), c.end(), [](VarId a, VarId b) {
+    return abs(a) < abs(b) || (abs(a) == abs(b) && a < b);
+  });
+  c.erase(std::unique(c.begin(), c.end()), c.end());
+  for (uint i = 1; i < c.size(); i++)
+    if (c[i] == -c[i - 1]) return;  // tautology
+  if (c.empty()) {
+    conflict_ = true;
+    return;
+  }
+  for (auto lit : c) {
+    assert(lit != 0 && (unsigned)abs(lit) < num_vars_);
+    occurs_[abs(lit)].push_back(clauses_.size());
+  }
+  clauses_.push_back(c);
+}
+
+uint ModelCounter::NextStamp() {
+  if (++stamp_counter_ == 0) {
+    // wrapped around; forget all stamps
+    std::fill(stamp_.begin(), stamp_.end(), 0);
+    std::fill(scratch_stamp_.begin(), scratch_stamp_.end(), 0);
+    stamp_counter_ = 1;
+  }
+  return stamp_counter_;
+}
+
+uint64_t ModelCounter::Count() {
+  if (conflict_) return 0;
+  cache_.clear();
+  uint64_t result = 0;
+  bool ok = true;
+  for (auto& c : clauses_)
+    if (c.size() == 1 && !(ok = Assign(c[0]))) break;
+  if (ok) {
+    vec<uint> clauses(clauses_.size());
+    std::iota(clauses.begin(), clauses.end(), 0);
+    vec<VarId> vars(num_vars_ > 0 ? num_vars_ - 1 : 0);
+    std::iota(vars.begin(), vars.end(), 1);
+    result = CountClauses(clauses, vars);
+  }
+  Undo(0);
+  return result;
+}
+
+bool ModelCounter::Satisfied(uint clause) const {
+  for (auto lit : clauses_[clause])
+    if (value(lit) > 0) return true;
+  return false;
+}
+
+bool ModelCounter::Assign(VarId lit) {
+  if (value(lit) != 0) return value(lit) > 0;
+  uint head = trail_.size();
+  value_[abs(lit)] = lit > 0 ? 1 : -1;
+  trail_.push_back(lit);
+  while (head < trail_.size()) {
+    auto var = abs(trail_[head++]);
+    for (auto c : occurs_[var]) {
+      VarId unit = 0;
+      uint unassigned = 0;
+      bool satisfied = false;
+      for (auto x : clauses_[c]) {
+        auto v = value(x);
+        if (v > 0) {
+          satisfied = true;
+          break;
+        }
+        if (v == 0) {
+          unit = x;
+          unassigned++;
+        }
+      }
+      if (satisfied || unassigned > 1) continue;
+      if (unassigned == 0) return false;
+      value_[abs(unit)] = unit > 0 ? 1 : -1;
+      trail_.push_back(unit);
+    }
+  }
+  return true;
+}
+
+void ModelCounter::Undo(uint trail_size) {
+  while (trail_.size() > trail_size) {
+    value_[abs(trail_.back())] = 0;
+    trail_.pop_back();
+  }
+}
+
+uint64_t ModelCounter::CountClauses(const vec<uint>& clauses,
+                                    const vec<VarId>& vars) {
+  // union-find over the unassigned variables of unsatisfied clauses;
+  // the scratch arrays are only valid for the current stamp
+  uint stamp = NextStamp();
+  auto find = [&](VarId x) {
+    while (parent_[x] != x) x = parent_[x] = parent_[parent_[x]];
+    return x;
+  };
+  vec<uint> open;
+  for (auto c : clauses) {
+    if (Satisfied(c)) continue;
+    open.push_back(c);
+    VarId first = 0;
+    for (auto lit : clauses_[c]) {
+      auto x = abs(lit);
+      if (value_[x] != 0) continue;
+      if (stamp_[x] != stamp) {
+        stamp_[x] = stamp;
+        parent_[x] = x;
+      }
+      if (first == 0)
+        first = x;
+      else
+        parent_[find(x)] = find(first);
+    }
+  }
+
+  uint64_t result = 1;
+  for (auto x : vars)
+    if (value_[x] == 0 && (unsigned)x < num_projected_ && stamp_[x] != stamp)
+      result = mul(result, 2);
+
+  // components in the order of their first clause; scratch_[root] is the
+  // index of the component of 'root' plus one
+  vec<vec<uint>> components;
+  for (auto c : open) {
+    VarId root = 0;
+    for (auto lit : clauses_[c])
+      if (value_[abs(lit)] == 0) {
+        root = find(abs(lit));
+        break;
+      }
+    assert(root != 0);
+    if (scratch_stamp_[root] != stamp) {
+      scratch_stamp_[root] = stamp;
+      components.push_back(vec<uint>());
+      scratch_[root] = components.size();
+    }
+    components[scratch_[root] - 1].push_back(c);
+  }
+  for (auto& component : components) {
+    result = mul(result, CountComponent(component));
+    if (result == 0) break;
+  }
+  return result;
+}
+
+uint64_t ModelCounter::CountComponent(const vec<uint>& clauses) {
+  // the component is identified by its clauses reduced by the assignment
+  uint stamp = NextStamp();
+  vec<VarId> key;
+  vec<VarId> vars;
+  for (auto c : clauses) {
+    for (auto lit : clauses_[c]) {
+      if (value(lit) != 0) continue;
+      key.push_back(lit);
+      auto x = abs(lit);
+      if (scratch_stamp_[x] != stamp) {
+        scratch_stamp_[x] = stamp;
+        scratch_[x] = 0;
+        vars.push_back(x);
+      }
+      scratch_[x]++;
+    }
+    key.push_back(0);
+  }
+  auto it = cache_.find(key);
+  if (it != cache_.end()) return it->second;
+
+  // branch on the projected variable occurring most often
+  VarId best = 0;
+  for (auto x : vars) {
+    if ((unsigned)x < num_projected_ &&
+        (best == 0 || scratch_[x] > scratch_[best])) {
+      best = x;
+    }
+  }
+  uint64_t result = 0;
+  if (best == 0) {
+    result = Satisfiable(clauses);
+  } else {
+    for (auto lit : { best, -best }) {
+      auto size = trail_.size();
+      if (Assign(lit)) result = add(result, CountClauses(clauses, vars));
+      Undo(size);
+    }
+  }
+
+  if (cache_.size() >= kMaxCacheEntries) cache_.clear();
+  cache_[key] = result;
+  return result;
+}
+
+bool ModelCounter::Satisfiable(const vec<uint>& clauses) {
+  VarId var = 0;
+  for (auto c : clauses) {
+    if (Satisfied(c)) continue;
+    for (auto lit : clauses_[c])
+      if (value(lit) == 0) {
+        var = abs(lit);
+        break;
+      }
+    if (var) break;
+  }
+  if (var == 0) return true;
+  for (auto lit : { var, -var }) {
+    auto size = trail_.size();
+    bool sat = Assign(lit) && Satisfiable(clauses);
+    Undo(size);
+    if (sat) return true;
+  }
+  return false;
+}
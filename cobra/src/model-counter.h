@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include "./common.h"
+
+#ifndef COBRA_SRC_MODEL_COUNTER_H_
+#define COBRA_SRC_MODEL_COUNTER_H_
+
+/**
+ * Exact model counter for formulas in CNF, in the style of DPLL-based
+ * counters: it branches on variables with unit propagation, splits the
+ * remaining clauses into independent components, whose counts multiply,
+ * and caches the counts of components.
+ * Models are projected onto the variables 1 .. num_projected - 1 (the
+ * original variables of a game); other variables, such as the ones from
+ * the Tseitin transformation, are only required to have some satisfying
+ * value. Branching is done on projected variables only; a component
+ * without them is just checked for satisfiability.
+ */
+class ModelCounter {
+  uint num_vars_;
+  uint num_projected_;
+  vec<vec<VarId>> clauses_;
+  vec<vec<uint>> occurs_;  // clauses containing each variable
+  bool conflict_ = false;  // an empty clause was added
+
+  vec<int8_t> value_;  // 1 = true, -1 = false, 0 = unassigned
+  vec<VarId> trail_;   // assigned literals in order of assignment
+
+  struct KeyHash {
+    size_t operator()(const vec<VarId>& key) const {
+      size_t h = key.size();
+      for (auto lit : key) h = h * 4256249 + lit;
+      return h;
+    }
+  };
+  std::unordered_map<vec<VarId>, uint64_t, KeyHash> cache_;
+
+  // scratch arrays indexed by variables, valid only for the entries
+  // stamped with the current stamp (see NextStamp)
+  vec<VarId> parent_;
+  vec<uint> stamp_;
+  vec<uint> scratch_;
+  vec<uint> scratch_stamp_;
+  uint stamp_counter_ = 0;
+
+ public:
+  /**
+   * Creates a counter for clauses over variables 1 .. num_vars - 1.
+   */
+  ModelCounter(uint num_vars, uint num_projected);
+
+  void AddClause(const vec<VarId>& clause);
+
+  /**
+   * Returns the number of models projected onto the projected variables.
+   */
+  uint64_t Count();
+
+ private:
+  int value(VarId lit) const { return lit > 0 ? value_[lit] : -value_[-lit]; }
+  bool Satisfied(uint clause) const;
+  uint NextStamp();
+
+  // Assigns 'lit' and propagates unit clauses; false on a conflict.
+  bool Assign(VarId lit);
+  void Undo(uint trail_size);
+
+  // Counts the models of the unsatisfied clauses among 'clauses', times
+  // two for every unassigned projected variable of 'vars' they do not use.
+  uint64_t CountClauses(const vec<uint>& clauses, const vec<VarId>& vars);
+  uint64_t CountComponent(const vec<uint>& clauses);
+  bool Satisfiable(const vec<uint>& clauses);
+};
+
+#endif  // COBRA_SRC_MODEL_COUNTER_H_
@@ -115,15 +115,28 @@ double OptimalGenerator::AnalyzeExperiment(Experiment& e, vec<int>& next, double
   double val = 0;
 
   // Lower bound check
+  auto lower_bound = [maxparts](double imodels) {
+    return 1 + (imodels > 1 ? log(imodels)/log(maxparts) : 0);
+  };
   vec<double> lb(e.type().outcomes().size(), 0);
-  for (uint i = 0; i < e.type().outcomes().size(); i++) {
-    double imodels = static_cast<double>(e.NumOfModels(i));
-    double ibound = 1 + (imodels > 1 ? log(imodels)/log(maxparts) : 0);
-    if (worst_ && ceil(ibound) >= bound) return bound;
-    if (!worst_) {
-      lb[i] = ibound;
-      val += imodels/models * lb[i];
+  if (worst_ && ceil(lower_bound(models)) >= bound) {
+    // only the outcomes with too many models matter, where the lower bound
+    // reaches the bound; no outcome has more models than 'models'
+    uint too_many = 0, most = models;
+    while (too_many < most) {
+      uint mid = too_many + (most - too_many) / 2;
+      if (ceil(lower_bound(mid)) >= bound)
+        most = mid;
+      else
+        too_many = mid + 1;
     }
+    for (uint i = 0; i < e.type().outcomes().size(); i++)
+      if (e.NumOfModelsAtLeast(i, too_many)) return bound;
+  }
+  for (uint i = 0; i < e.type().outcomes().size() && !worst_; i++) {
+    double imodels = static_cast<double>(e.NumOfModels(i));
+    lb[i] = lower_bound(imodels);
+    val += imodels/models * lb[i];
     //printf("%2.f\n", val);
   }
   if (!worst_ && val >= bound) return bound;
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./outcome-table.h"
+
+#include <cassert>
+#include <vector>
+#include <map>
+#include "./compiled-formula.h"
+#include "./experiment.h"
+#include "./game.h"
+#include "./common.h"
+
+const uint8_t OutcomeTable::kNoOutcome;
+
+OutcomeTable::OutcomeTable(const Game& game, const vec<vec<uint64_t>>& codes,
+                           uint num_codes, uint64_t max_cells)
+    : num_codes_(num_codes) {
+  included_.assign(game.experiments().size(), false);
+  if (num_codes_ == 0) return;
+  uint words = (num_codes_ + 63) / 64;
+  vec<uint64_t> regs;
+  for (uint t = 0; t < game.experiments().size(); t++) {
+    auto type = game.experiments()[t];
+    if (type->outcomes().size() >= kNoOutcome) continue;
+    auto cells = type->NumberOfParametrizations() * num_codes_;
+    if (own_cells_.size() + cells > max_cells) continue;
+    included_[t] = true;
+    auto& index = columns_[type];
+    type->ForAllParametrizations([&](const vec<CharId>& params) {
+      auto first = own_cells_.size();
+      own_cells_.resize(first + num_codes_, kNoOutcome);
+      uint8_t* column = own_cells_.data() + first;
+      bool exact = true;
+      for (uint o = 0; o < type->outcomes().size(); o++) {
+        CompiledFormula f(type->outcomes()[o].formula, &params);
+        for (uint w = 0; w < words; w++) {
+          for (auto bits = f.Evaluate(codes, w, regs); bits; bits &= bits - 1) {
+            uint code = 64 * w + ctz(bits);
+            if (code >= num_codes_) break;  // padding of the last word
+            if (column[code] != kNoOutcome) exact = false;
+            column[code] = o;
+          }
+        }
+      }
+      if (exact) index[params] = num_columns_;
+      exact_.push_back(exact);
+      num_columns_++;
+    });
+  }
+  cells_ = own_cells_.data();
+}
+
+OutcomeTable::OutcomeTable(const Game& game, uint num_codes,
+                           const uint8_t* included, const uint8_t* exact,
+                           const uint8_t* cells)
+    : num_codes_(num_codes),
+      cells_(cells) {
+  included_.assign(included, included + game.experiments().size());
+  for (uint t = 0; t < game.experiments().size(); t++) {
+    if (!included_[t]) continue;
+    auto type = game.experiments()[t];
+    auto& index = columns_[type];
+    type->ForAllParametrizations([&](const vec<CharId>& params) {
+      if (exact[num_columns_]) index[params] = num_columns_;
+      exact_.push_back(exact[num_columns_]);
+      num_columns_++;
+    });
+  }
+}
+
+const uint8_t* OutcomeTable::Column(const ExpType& type,
+                                    const vec<CharId>& params) const {
+  auto t = columns_.find(&type);
+  if (t == columns_.end()) return nullptr;
+  auto c = t->second.find(params);
+  if (c == t->second.end()) return nullptr;
+  return cells_ + static_cast<uint64_t>(c->second) * num_codes_;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include "./common.h"
+
+#ifndef COBRA_SRC_OUTCOME_TABLE_H_
+#define COBRA_SRC_OUTCOME_TABLE_H_
+
+class Game;
+class ExpType;
+
+/**
+ * Precomputed outcomes of all experiments on all codes of a game.
+ * The table has one column per parametrization of every experiment type
+ * (in the order of ExpType::ForAllParametrizations) and one cell per code,
+ * holding the index of the outcome the code falls into. Columns are stored
+ * contiguously, so partitioning a set of codes by an experiment is a single
+ * counting pass over one column.
+ */
+class OutcomeTable {
+  uint num_codes_;
+  uint64_t num_columns_ = 0;
+  vec<uint8_t> own_cells_;
+  const uint8_t* cells_ = nullptr;  // cells_[column * num_codes_ + code]
+
+  // included_[t] tells whether experiment type t is in the table;
+  // exact_[c] tells whether every code satisfies at most one outcome in
+  // column c. Together they determine columns_ (and are stored in caches).
+  vec<uint8_t> included_;
+  vec<uint8_t> exact_;
+
+  // Column of every parametrization present in the table. Experiment types
+  // that do not fit the size limit, or parametrizations for which some code
+  // satisfies more than one outcome, are left out.
+  std::map<const ExpType*, std::map<vec<CharId>, uint>> columns_;
+
+ public:
+  // Value of a cell for a code that satisfies no outcome.
+  static const uint8_t kNoOutcome = 255;
+
+  /**
+   * Evaluates all experiments of 'game' on the bit-sliced code set 'codes'
+   * with 'num_codes' codes (see SimpleSolver). Experiment types are added
+   * in order while the table has at most 'max_cells' cells.
+   */
+  OutcomeTable(const Game& game, const vec<vec<uint64_t>>& codes,
+               uint num_codes, uint64_t max_cells);
+
+  /**
+   * Creates a table over cells computed earlier (see SimpleCache).
+   * The arrays are not copied and must outlive the table.
+   */
+  OutcomeTable(const Game& game, uint num_codes, const uint8_t* included,
+               const uint8_t* exact, const uint8_t* cells);
+
+  uint num_codes() const { return num_codes_; }
+  uint64_t num_columns() const { return num_columns_; }
+  uint64_t num_cells() const { return num_columns_ * num_codes_; }
+  const vec<uint8_t>& included() const { return included_; }
+  const vec<uint8_t>& exact() const { return exact_; }
+  const uint8_t* cells() const { return cells_; }
+
+  /**
+   * Returns the column of an experiment, or nullptr if it is not present.
+   * Cell 'code' of the column is the outcome of the experiment on the code.
+   */
+  const uint8_t* Column(const ExpType& type, const vec<CharId>& params) const;
+};
+
+#endif  // COBRA_SRC_OUTCOME_TABLE_H_
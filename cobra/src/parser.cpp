@@ -16,4 +16,5 @@ Parser m;
 void Parser::deleteAll() {
   for (auto& n : nodes_) delete n;
   nodes_.clear();
+  shared_.clear();
 }
@@ -9,6 +9,7 @@
 #include <exception>
 #include <cassert>
 #include <string>
+#include <utility>
 #include "./common.h"
 #include "./game.h"
 
@@ -36,6 +37,9 @@ class ParserException: public std::exception {
 
 class Parser {
   vec<Formula*> nodes_;
+  // Immutable nodes by name and children, so that structurally equal
+  // subformulas are represented by a single node (hash-consing).
+  std::map<std::pair<string, vec<Formula*>>, Formula*> shared_;
   std::map<string, Variable*> variables_;
   Formula* last_;
 
@@ -48,6 +52,8 @@ class Parser {
  public:
   /**
    * Creates a new node of type T; call the constructor with parameters ts.
+   * If an equal immutable node exists already, it is returned instead,
+   * so formulas form a DAG rather than a tree.
    * This just calls a private get method with the itenity<T> as the first argument,
    * which can be easily overloaded for different types (e.g., for Variable and string).
    */
@@ -81,6 +87,7 @@ class Parser {
   void reset() {
     Game g;
     game_ = g;
+    shared_.clear();  // mappings of the new game may differ
   }
 
   template <class T>
@@ -106,11 +113,21 @@ class Parser {
   /**
    * Generic template for a get method, which creates a new node.
    * It just calls the constructor with given parameters (ts) and stores the
-   * created object to nodes_ vector.
+   * created object to nodes_ vector. Immutable nodes are hash-consed.
    */
   template<typename T, typename... Ts>
   T* get(identity<T>, const Ts&... ts) {
     T* node = new T(ts...);
+    if (node->immutable()) {
+      auto key = std::make_pair(node->name(), node->children());
+      auto it = shared_.find(key);
+      if (it != shared_.end()) {
+        delete node;
+        last_ = it->second;
+        return static_cast<T*>(it->second);
+      }
+      shared_[key] = node;
+    }
     nodes_.push_back(node);
     last_ = node;
     return node;
@@ -20,6 +20,11 @@ extern "C" {
 #include "./formula.h"
 #include "./common.h"
 
+namespace {
+  // Propagations between two checks for an interrupt.
+  const unsigned long long kSlice = 1 << 20;
+}  // namespace
+
 SolverStats PicoSolver::stats_ = SolverStats();
 
 PicoSolver::PicoSolver(uint var_count, Formula* constraint) {
@@ -40,15 +45,7 @@ PicoSolver::~PicoSolver() {
 //------------------------------------------------------------------------------
 // Adding constraints
 
-void PicoSolver::AddClause(const vec<VarId>& list) {
-  for (auto l : list) {
-    assert(l != 0);
-    picosat_add(picosat_, l);
-  }
-  picosat_add(picosat_, 0);
-}
-
-void PicoSolver::AddClause(std::initializer_list<VarId> list) {
+void PicoSolver::_AddClause(const vec<VarId>& list) {
   for (auto l : list) {
     assert(l != 0);
     picosat_add(picosat_, l);
@@ -58,11 +55,11 @@ void PicoSolver::AddClause(std::initializer_list<VarId> list) {
 
 //------------------------------------------------------------------------------
 
-void PicoSolver::OpenContext() {
+void PicoSolver::_OpenContext() {
   picosat_push(picosat_);
 }
 
-void PicoSolver::CloseContext() {
+void PicoSolver::_CloseContext() {
   picosat_pop(picosat_);
 }
 
@@ -70,39 +67,32 @@ void PicoSolver::CloseContext() {
 //------------------------------------------------------------------------------
 // SAT solver stuff
 
+bool PicoSolver::Solve(VarId assumption) {
+  while (true) {
+    // assumptions only hold for one call
+    for (auto lit : assumptions()) picosat_assume(picosat_, lit);
+    if (assumption) picosat_assume(picosat_, assumption);
+    picosat_set_propagation_limit(picosat_,
+                                  picosat_propagations(picosat_) + kSlice);
+    auto result = picosat_sat(picosat_, -1);
+    if (result == PICOSAT_SATISFIABLE) ModelFound();
+    if (result != PICOSAT_UNKNOWN) return result == PICOSAT_SATISFIABLE;
+    if (interrupted()) return false;
+  }
+}
+
 bool PicoSolver::_MustBeTrue(VarId id) {
   assert(id > 0);
-  picosat_assume(picosat_, -id);
-  return !_Satisfiable();
+  return !Solve(-id);
 }
 
 bool PicoSolver::_MustBeFalse(VarId id) {
   assert(id > 0);
-  picosat_assume(picosat_, id);
-  return !_Satisfiable();
-}
-
-vec<VarId> PicoSolver::_GetFixedVars() {
-  vec<VarId> result;
-  for (uint id = 1; id < var_count_; id++) {
-    if (_MustBeTrue(id)) result.push_back(id);
-    if (_MustBeFalse(id)) result.push_back(-id);
-  }
-  return result;
-}
-
-uint PicoSolver::_GetNumOfFixedVars() {
-  uint r = 0;
-  for (uint id = 1; id < var_count_; id++) {
-    r += _MustBeTrue(id);
-    r += _MustBeFalse(id);
-  }
-  return r;
+  return !Solve(id);
 }
 
 bool PicoSolver::_Satisfiable() {
-  auto result = picosat_sat(picosat_, -1);
-  return (result == PICOSAT_SATISFIABLE);
+  return Solve(0);
 }
 
 vec<bool> PicoSolver::GetModel() {
@@ -113,38 +103,36 @@ vec<bool> PicoSolver::GetModel() {
   return result;
 }
 
-void PicoSolver::ForAllModels(VarId var, std::function<void()> callback) {
+void PicoSolver::ForAllModels(
+    std::function<bool(const vec<bool>&)> callback) {
+  ForAllModels(1, callback);
+}
+
+bool PicoSolver::ForAllModels(
+    VarId var, const std::function<bool(const vec<bool>&)>& callback) {
   assert(var > 0 && (unsigned)var < var_count_);
   for (VarId v : std::initializer_list<VarId>({var, -var})) {
-    picosat_assume(picosat_, v);
-    if (picosat_sat(picosat_, -1) == PICOSAT_SATISFIABLE) {
-      if ((unsigned)var == var_count_ - 1) {
-        callback();
-      } else {
-        picosat_push(picosat_);
-        picosat_add(picosat_, v);
-        picosat_add(picosat_, 0);
-        ForAllModels(var + 1, callback);
-        picosat_pop(picosat_);
-      }
+    if (!Solve(v)) continue;
+    bool go_on;
+    if ((unsigned)var == var_count_ - 1) {
+      go_on = callback(GetModel());
+    } else {
+      picosat_push(picosat_);
+      picosat_add(picosat_, v);
+      picosat_add(picosat_, 0);
+      go_on = ForAllModels(var + 1, callback);
+      picosat_pop(picosat_);
     }
+    if (!go_on) return false;
   }
-}
-
-uint PicoSolver::_NumOfModels() {
-  uint k = 0;
-  ForAllModels(1, [&]() { k++; });
-  return k;
+  return true;
 }
 
 vec<vec<bool>> PicoSolver::_GenerateModels() {
   vec<vec<bool>> models;
-  ForAllModels(1, [&]() {
-    vec<bool> n(var_count_, false);
-    for (uint id = 1; id < var_count_; id++) {
-      if (picosat_deref(picosat_, id) == 1) n[id] = true;
-    }
-    models.push_back(n);
+  ForAllModels([&](const vec<bool>& model) {
+    models.push_back(model);
+    return true;
   });
   return models;
 }
@@ -9,6 +9,7 @@ extern "C" {
 }
 
 #include <cassert>
+#include <functional>
 #include <vector>
 #include <map>
 #include <set>
@@ -32,36 +33,46 @@ class PicoSolver: public CnfSolver {
   SolverStats& stats() { return stats_; }
   static SolverStats& s_stats() { return stats_; }
 
-  void AddClause(const vec<VarId>& list);
-  void AddClause(std::initializer_list<VarId> list);
-
-  void OpenContext();
-  void CloseContext();
 
   void WriteDimacs(FILE* f) {
     picosat_print(picosat_, f);
   }
 
-  VarId NewVarId() {
+  vec<bool> GetModel();
+
+  // uint NumOfModelsSharpSat();
+
+ private:
+  VarId _NewVarId() {
     assert(picosat_);
     int k = picosat_inc_max_var(picosat_);
     return k;
   }
 
-  vec<bool> GetModel();
+  void _AddClause(const vec<VarId>& list);
+  void _OpenContext();
+  void _CloseContext();
 
-  // uint NumOfModelsSharpSat();
-
- private:
   bool _MustBeTrue(VarId id);
   bool _MustBeFalse(VarId id);
-  vec<VarId> _GetFixedVars();
-  uint _GetNumOfFixedVars();
   bool _Satisfiable();
-  uint _NumOfModels();
   vec<vec<bool>> _GenerateModels();
 
-  void ForAllModels(VarId var, std::function<void()> callback);
+  /**
+   * Solves the current constraints under the assumptions of CnfSolver and
+   * an optional one (0 for none). The search runs in slices, so that it
+   * can be interrupted.
+   */
+  bool Solve(VarId assumption);
+
+  void ForAllModels(std::function<bool(const vec<bool>&)> callback);
+
+  /**
+   * Enumerates the models with the values of variables 1 .. var - 1 fixed
+   * by the enclosing calls; false if the callback stopped it.
+   */
+  bool ForAllModels(VarId var,
+                    const std::function<bool(const vec<bool>&)>& callback);
 };
 
 #endif  // COBRA_SRC_PICOSOLVER_H_
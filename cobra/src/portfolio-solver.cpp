@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./portfolio-solver.h"
+
+#include <cassert>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "./minisolver.h"
+#include "./picosolver.h"
+#include "./common.h"
+
+SolverStats PortfolioSolver::stats_ = SolverStats();
+
+PortfolioSolver::PortfolioSolver(uint var_count, uint size)
+    : pool_(size) {
+  assert(size >= 2);
+  var_count_ = var_count;
+  members_.emplace_back(new MiniSolver(var_count));
+  members_.emplace_back(new PicoSolver(var_count));
+  for (uint seed = 1; members_.size() < size; seed++)
+    members_.emplace_back(new MiniSolver(var_count, nullptr, seed));
+}
+
+vec<CnfSolver*> PortfolioSolver::members() const {
+  vec<CnfSolver*> result;
+  for (auto& s : members_) result.push_back(s.get());
+  return result;
+}
+
+//------------------------------------------------------------------------------
+// Adding constraints; the Tseitin transformation keeps its state in the
+// formula, so the members take their turns.
+
+void PortfolioSolver::AddConstraint(Formula* formula) {
+  for (auto& s : members_) s->AddConstraint(formula);
+}
+
+void PortfolioSolver::AddConstraint(Formula* formula,
+                                    const vec<CharId>& params) {
+  for (auto& s : members_) s->AddConstraint(formula, params);
+}
+
+void PortfolioSolver::OpenContext() {
+  for (auto& s : members_) s->OpenContext();
+}
+
+void PortfolioSolver::CloseContext() {
+  for (auto& s : members_) s->CloseContext();
+}
+
+void PortfolioSolver::BeginBatch() {
+  for (auto& s : members_) s->BeginBatch();
+}
+
+void PortfolioSolver::EndBatch() {
+  for (auto& s : members_) s->EndBatch();
+}
+
+//------------------------------------------------------------------------------
+// SAT solver stuff
+
+bool PortfolioSolver::Race(const std::function<bool(Solver*)>& query) {
+  std::atomic<int> winner(-1);
+  bool result = false;
+  pool_.Run([&](uint i) {
+    // members do not share any state, so they can be queried in parallel
+    auto r = query(members_[i].get());
+    int none = -1;
+    if (!winner.compare_exchange_strong(none, i)) return;
+    result = r;
+    for (uint j = 0; j < members_.size(); j++)
+      if (j != i) members_[j]->Interrupt();
+  });
+  // the losers must answer later queries that are not raced
+  for (auto& s : members_) s->ClearInterrupt();
+  winner_ = winner;
+  return result;
+}
+
+bool PortfolioSolver::_MustBeTrue(VarId id) {
+  return Race([id](Solver* s) { return s->_MustBeTrue(id); });
+}
+
+bool PortfolioSolver::_MustBeFalse(VarId id) {
+  return Race([id](Solver* s) { return s->_MustBeFalse(id); });
+}
+
+bool PortfolioSolver::_Satisfiable() {
+  return Race([](Solver* s) { return s->_Satisfiable(); });
+}
+
+vec<bool> PortfolioSolver::GetModel() {
+  return members_[winner_]->GetModel();
+}
+
+bool PortfolioSolver::_OnlyOneModel() {
+  // needs the model of the last successful Satisfiable
+  return members_[winner_]->OnlyOneModel();
+}
+
+vec<VarId> PortfolioSolver::_GetFixedVars() {
+  winner_ = 0;
+  return members_[0]->GetFixedVars();
+}
+
+uint PortfolioSolver::_GetNumOfFixedVars() {
+  winner_ = 0;
+  return members_[0]->GetNumOfFixedVars();
+}
+
+uint PortfolioSolver::_NumOfModels() {
+  winner_ = 0;
+  return members_[0]->NumOfModels();
+}
+
+vec<vec<bool>> PortfolioSolver::_GenerateModels() {
+  winner_ = 0;
+  return members_[0]->GenerateModels();
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "./common.h"
+#include "./solver.h"
+#include "./thread-pool.h"
+
+#ifndef COBRA_SRC_PORTFOLIO_SOLVER_H_
+#define COBRA_SRC_PORTFOLIO_SOLVER_H_
+
+class Formula;
+
+/**
+ * Runs several CNF solvers side by side: a MiniSolver, a PicoSolver and
+ * randomized MiniSolvers with different seeds. All constraints and
+ * contexts are mirrored to every member. Satisfiable, MustBeTrue and
+ * MustBeFalse are run by all members in parallel, each on its own thread;
+ * the first answer is taken and the other members are interrupted. Other
+ * queries are answered by the first member alone.
+ * Models (see GetModel) come from the member that answered the last
+ * query, so they may differ between runs.
+ */
+class PortfolioSolver: public Solver {
+  static SolverStats stats_;
+
+  vec<std::unique_ptr<CnfSolver>> members_;
+  ThreadPool pool_;
+  uint winner_ = 0;  // member that answered the last query
+
+ public:
+  /**
+   * Creates a portfolio of 'size' members (at least two).
+   */
+  PortfolioSolver(uint var_count, uint size);
+
+  SolverStats& stats() { return stats_; }
+  static SolverStats& s_stats() { return stats_; }
+
+  /**
+   * Gives access to the members, e.g. to set their options. This must be
+   * done before any constraint is added.
+   */
+  vec<CnfSolver*> members() const;
+
+  void AddConstraint(Formula* formula);
+  void AddConstraint(Formula* formula, const vec<CharId>& params);
+  void OpenContext();
+  void CloseContext();
+  void BeginBatch();
+  void EndBatch();
+
+  vec<bool> GetModel();
+
+ protected:
+  bool _MustBeTrue(VarId id);
+  bool _MustBeFalse(VarId id);
+  vec<VarId> _GetFixedVars();
+  uint _GetNumOfFixedVars();
+  bool _Satisfiable();
+  bool _OnlyOneModel();
+  uint _NumOfModels();
+  vec<vec<bool>> _GenerateModels();
+
+ private:
+  /**
+   * Runs 'query' on all members in parallel and returns the first answer.
+   */
+  bool Race(const std::function<bool(Solver*)>& query);
+};
+
+#endif  // COBRA_SRC_PORTFOLIO_SOLVER_H_
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./preprocessor.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <minisat/simp/SimpSolver.h>
+#include "./common.h"
+
+namespace {
+  /**
+   * SimpSolver giving access to the clauses and the top-level assignment
+   * that remain after the simplification.
+   */
+  class Simplifier: public Minisat::SimpSolver {
+   public:
+    template<typename F>
+    void ForAllClauses(F f) const {
+      for (int i = 0; i < clauses.size(); i++) f(ca[clauses[i]]);
+    }
+    template<typename F>
+    void ForAllUnits(F f) const {
+      for (int i = 0; i < trail.size(); i++) f(trail[i]);
+    }
+  };
+}  // namespace
+
+vec<vec<VarId>> Preprocess(const vec<vec<VarId>>& clauses, uint num_vars,
+                           uint num_frozen, uint* aux_count) {
+  assert(num_frozen <= num_vars);
+  Simplifier s;
+  for (uint id = 1; id < num_vars; id++) {
+    auto x = s.newVar();
+    if (id < num_frozen) s.setFrozen(x, true);
+  }
+  Minisat::vec<Minisat::Lit> v;
+  bool ok = true;
+  for (auto& c : clauses) {
+    v.clear();
+    for (auto lit : c) {
+      assert(lit != 0 && (unsigned)abs(lit) < num_vars);
+      v.push(Minisat::mkLit(abs(lit) - 1, lit > 0));
+    }
+    if (!(ok = s.addClause_(v))) break;
+  }
+  *aux_count = 0;
+  if (!ok || !s.eliminate(true) || !s.simplify()) return { vec<VarId>() };
+
+  // renumber the remaining non-frozen variables
+  vec<VarId> id(num_vars, 0);
+  for (uint i = 1; i < num_frozen; i++) id[i] = i;
+  auto convert = [&](Minisat::Lit l) {
+    auto x = Minisat::var(l) + 1;
+    if (id[x] == 0) id[x] = num_frozen + (*aux_count)++;
+    return Minisat::sign(l) ? id[x] : -id[x];
+  };
+
+  vec<vec<VarId>> result;
+  s.ForAllUnits([&](Minisat::Lit l) {
+    result.push_back({ convert(l) });
+  });
+  s.ForAllClauses([&](const Minisat::Clause& c) {
+    vec<VarId> clause;
+    for (int i = 0; i < c.size(); i++) {
+      // clauses satisfied at the top level are already removed
+      if (Minisat::toInt(s.value(c[i])) == 1) continue;  // false
+      clause.push_back(convert(c[i]));
+    }
+    result.push_back(clause);
+  });
+  return result;
+}
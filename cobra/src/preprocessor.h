@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <vector>
+#include "./common.h"
+
+#ifndef COBRA_SRC_PREPROCESSOR_H_
+#define COBRA_SRC_PREPROCESSOR_H_
+
+/**
+ * Simplifies a CNF over variables 1 .. num_vars - 1 with Minisat's
+ * SimpSolver (variable elimination, subsumption and strengthening).
+ * Variables 1 .. num_frozen - 1 (the original variables of a game) are
+ * kept, the others may be eliminated. The result has the same models
+ * projected onto the kept variables; the remaining other variables are
+ * renumbered from num_frozen up and their number is stored in 'aux_count'.
+ * An unsatisfiable CNF results in a single empty clause.
+ */
+vec<vec<VarId>> Preprocess(const vec<vec<VarId>>& clauses, uint num_vars,
+                           uint num_frozen, uint* aux_count);
+
+#endif  // COBRA_SRC_PREPROCESSOR_H_
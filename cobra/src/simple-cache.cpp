@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./simple-cache.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "./outcome-table.h"
+#include "./common.h"
+
+namespace {
+  const char kMagic[8] = { 'C', 'O', 'B', 'R', 'A', 'C', 'C', '\0' };
+
+  uint64_t align8(uint64_t x) {
+    return (x + 7) & ~uint64_t(7);
+  }
+}  // namespace
+
+const uint32_t SimpleCache::kVersion;
+
+SimpleCache::SimpleCache(const string& filename, uint64_t hash,
+                         uint var_count) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header)) {
+    size_ = st.st_size;
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data_ == MAP_FAILED) data_ = nullptr;
+  }
+  close(fd);
+  if (!data_) return;
+
+  auto h = static_cast<const Header*>(data_);
+  if (memcmp(h->magic, kMagic, sizeof(kMagic)) == 0 &&
+      h->version == kVersion && h->hash == hash &&
+      h->var_count == var_count && FileSize(*h) == size_) {
+    header_ = h;
+  }
+}
+
+SimpleCache::~SimpleCache() {
+  if (data_) munmap(data_, size_);
+}
+
+const uint64_t* SimpleCache::column(VarId id) const {
+  assert(valid() && id >= 0 && (unsigned)id < header_->var_count);
+  auto base = static_cast<const char*>(data_) + sizeof(Header);
+  return reinterpret_cast<const uint64_t*>(base) + id * words();
+}
+
+bool SimpleCache::has_table(uint64_t max_cells) const {
+  return valid() && max_cells > 0 && header_->table_limit == max_cells;
+}
+
+const uint8_t* SimpleCache::table_included() const {
+  assert(header_->table_limit > 0);
+  return static_cast<const uint8_t*>(data_) + TableOffset(*header_);
+}
+
+const uint8_t* SimpleCache::table_exact() const {
+  return table_included() + header_->num_types;
+}
+
+const uint8_t* SimpleCache::table_cells() const {
+  auto offset = align8(TableOffset(*header_) + header_->num_types +
+                       header_->table_columns);
+  return static_cast<const uint8_t*>(data_) + offset;
+}
+
+uint64_t SimpleCache::TableOffset(const Header& h) {
+  return sizeof(Header) + h.var_count * ((h.num_codes + 63) / 64) * 8;
+}
+
+uint64_t SimpleCache::FileSize(const Header& h) {
+  if (h.table_limit == 0) return TableOffset(h);
+  return align8(TableOffset(h) + h.num_types + h.table_columns) +
+         h.table_columns * h.num_codes;
+}
+
+bool SimpleCache::Write(const string& filename, uint64_t hash,
+                        const vec<vec<uint64_t>>& columns, uint num_codes,
+                        const OutcomeTable* table, uint64_t max_cells) {
+  Header h;
+  memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.var_count = columns.size();
+  h.hash = hash;
+  h.num_codes = num_codes;
+  h.table_limit = table ? max_cells : 0;
+  h.table_columns = table ? table->num_columns() : 0;
+  h.num_types = table ? table->included().size() : 0;
+
+  auto tmp = filename + ".tmp" + std::to_string(getpid());
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (!f) return false;
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  for (auto& column : columns) {
+    assert(column.size() == (num_codes + 63) / 64);
+    ok = ok && fwrite(column.data(), 8, column.size(), f) == column.size();
+  }
+  if (table) {
+    auto& included = table->included();
+    auto& exact = table->exact();
+    ok = ok && fwrite(included.data(), 1, included.size(), f) ==
+               included.size();
+    ok = ok && fwrite(exact.data(), 1, exact.size(), f) == exact.size();
+    auto pos = TableOffset(h) + included.size() + exact.size();
+    const char padding[8] = { 0 };
+    auto pad = align8(pos) - pos;
+    ok = ok && fwrite(padding, 1, pad, f) == pad;
+    ok = ok && fwrite(table->cells(), 1, table->num_cells(), f) ==
+               table->num_cells();
+  }
+  ok = (fclose(f) == 0) && ok;
+  if (ok) ok = rename(tmp.c_str(), filename.c_str()) == 0;
+  if (!ok) remove(tmp.c_str());
+  return ok;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include "./common.h"
+
+#ifndef COBRA_SRC_SIMPLE_CACHE_H_
+#define COBRA_SRC_SIMPLE_CACHE_H_
+
+class OutcomeTable;
+
+/**
+ * Binary on-disk cache of the code set of SimpleSolver and, optionally,
+ * of its outcome table. The file is memory-mapped read-only, so loading is
+ * nearly free and processes working on the same game share the pages.
+ * A cache file is used only if its format version, game hash and number
+ * of variables match; otherwise it is ignored (and rewritten by the caller).
+ *
+ * Layout (native byte order, sections aligned to 8 bytes):
+ *  - Header
+ *  - code columns: var_count x words 64-bit words (see SimpleSolver)
+ *  - if table_limit > 0: OutcomeTable::included() (num_types bytes),
+ *    OutcomeTable::exact() (table_columns bytes), table cells
+ *    (table_columns x num_codes bytes)
+ */
+class SimpleCache {
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t var_count;
+    uint64_t hash;
+    uint64_t num_codes;
+    uint64_t table_limit;  // max_cells the table was built with, 0 = none
+    uint64_t table_columns;
+    uint64_t num_types;
+  };
+
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  const Header* header_ = nullptr;
+
+ public:
+  static const uint32_t kVersion = 1;
+
+  /**
+   * Maps the file 'filename', if it exists and is a valid cache for a game
+   * with the given hash and number of variables.
+   */
+  SimpleCache(const string& filename, uint64_t hash, uint var_count);
+  ~SimpleCache();
+
+  /**
+   * Returns true if the codes were loaded.
+   */
+  bool valid() const { return header_ != nullptr; }
+  uint num_codes() const { return header_->num_codes; }
+  uint words() const { return (header_->num_codes + 63) / 64; }
+
+  /**
+   * Gets the column of variable 'id' (an array of 'words()' words).
+   */
+  const uint64_t* column(VarId id) const;
+
+  /**
+   * Returns true if the file contains an outcome table built with the size
+   * limit 'max_cells'.
+   */
+  bool has_table(uint64_t max_cells) const;
+  const uint8_t* table_included() const;
+  const uint8_t* table_exact() const;
+  const uint8_t* table_cells() const;
+
+  /**
+   * Writes a cache file; 'table' may be nullptr. The file is written under
+   * a temporary name and renamed, so that concurrent readers never see
+   * a partial file. Returns false on failure.
+   */
+  static bool Write(const string& filename, uint64_t hash,
+                    const vec<vec<uint64_t>>& columns, uint num_codes,
+                    const OutcomeTable* table, uint64_t max_cells);
+
+ private:
+  // Offsets of the sections for a given header.
+  static uint64_t TableOffset(const Header& h);
+  static uint64_t FileSize(const Header& h);
+};
+
+#endif  // COBRA_SRC_SIMPLE_CACHE_H_
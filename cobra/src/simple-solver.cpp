@@ -4,8 +4,12 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include "./formula.h"
+#include "./experiment.h"
+#include "./game.h"
 #include "./simple-solver.h"
 #include "./minisolver.h"
 
@@ -16,26 +20,118 @@ SimpleSolver::SimpleSolver(uint var_count,
     constraint_(constraint) {
   var_count_ = var_count;
   MiniSolver sat(var_count, constraint);
-  codes_ = sat.GenerateModels();
-  for (uint i = 0; i < codes_.size(); i++) {
-    sat_.push_back(i);
+  auto codes = sat.GenerateModels();
+  vec<vec<uint64_t>> columns(var_count_,
+                             vec<uint64_t>((codes.size() + 63) / 64, 0));
+  for (uint i = 0; i < codes.size(); i++)
+    for (uint id = 1; id < var_count_; id++)
+      if (codes[i][id]) columns[id][i / 64] |= uint64_t(1) << (i % 64);
+  Init(std::move(columns), codes.size());
+}
+
+SimpleSolver::SimpleSolver(uint var_count, Formula* constraint,
+                           SimpleCache* cache) :
+    constraint_(constraint),
+    cache_(cache) {
+  assert(cache && cache->valid());
+  var_count_ = var_count;
+  vec<vec<uint64_t>> columns;
+  for (uint id = 0; id < var_count_; id++) {
+    auto column = cache->column(id);
+    columns.push_back(vec<uint64_t>(column, column + cache->words()));
+  }
+  Init(std::move(columns), cache->num_codes());
+}
+
+SimpleSolver::~SimpleSolver() {
+  delete pool_;
+  delete table_;
+  delete cache_;
+}
+
+SimpleSolver* SimpleSolver::LoadCached(const string& filename,
+                                       const Game& game, uint64_t max_cells) {
+  auto hash = game.Hash();
+  auto cache = new SimpleCache(filename, hash, game.vars().size());
+  SimpleSolver* solver;
+  if (cache->valid()) {
+    solver = new SimpleSolver(game.vars().size(), game.constraint(), cache);
+    if (max_cells == 0) return solver;
+    if (cache->has_table(max_cells)) {
+      solver->table_ = new OutcomeTable(game, solver->num_codes_,
+                                        cache->table_included(),
+                                        cache->table_exact(),
+                                        cache->table_cells());
+      return solver;
+    }
+  } else {
+    delete cache;
+    solver = new SimpleSolver(game.vars().size(), game.constraint());
   }
+  if (max_cells > 0) solver->PrecomputeOutcomes(game, max_cells);
+  if (!SimpleCache::Write(filename, hash, solver->columns_,
+                          solver->num_codes_, solver->table_, max_cells)) {
+    printf("Cannot write cache %s.\n", filename.c_str());
+  }
+  return solver;
+}
+
+void SimpleSolver::Init(vec<vec<uint64_t>>&& columns, uint num_codes) {
+  num_codes_ = num_codes;
+  words_ = (num_codes_ + 63) / 64;
+  columns_ = std::move(columns);
+  live_.assign(words_, 0);
+  sat_.resize(num_codes_);
+  for (uint i = 0; i < num_codes_; i++) {
+    sat_[i] = i;
+    SetLive(i, true);
+  }
+  num_sat_ = num_codes_;
   ready_ = true;
 }
 
+void SimpleSolver::PrecomputeOutcomes(const Game& game, uint64_t max_cells) {
+  delete table_;
+  table_ = new OutcomeTable(game, columns_, num_codes_, max_cells);
+}
+
+void SimpleSolver::SetThreads(uint threads) {
+  delete pool_;
+  pool_ = threads > 1 ? new ThreadPool(threads) : nullptr;
+  pool_regs_.assign(threads, vec<uint64_t>());
+}
+
+vec<bool> SimpleSolver::Code(uint code) const {
+  vec<bool> result(var_count_, false);
+  for (uint id = 1; id < var_count_; id++)
+    result[id] = (columns_[id][code / 64] >> (code % 64)) & 1;
+  return result;
+}
+
+void SimpleSolver::SetLive(uint code, bool value) {
+  auto bit = uint64_t(1) << (code % 64);
+  if (value)
+    live_[code / 64] |= bit;
+  else
+    live_[code / 64] &= ~bit;
+}
+
 void SimpleSolver::AddConstraint(Formula* formula) {
   ready_ = false;
   constraints_.push_back(make_pair(formula, vec<CharId>()));
+  compiled_.push_back(CompiledFormula(formula, nullptr));
 }
 
 void SimpleSolver::AddConstraint(Formula* formula, const vec<CharId>& params) {
   ready_ = false;
   constraints_.push_back(make_pair(formula, params));
+  compiled_.push_back(CompiledFormula(formula, &params));
 }
 
 void SimpleSolver::OpenContext() {
   contexts_.push_back(constraints_.size());
-  context_unsat_.push_back(vec<uint>());
+  context_sat_.push_back(num_sat_);
+  context_applied_.push_back(applied_);
 }
 
 void SimpleSolver::CloseContext() {
@@ -43,27 +139,32 @@ void SimpleSolver::CloseContext() {
   // remove constraints added in this context
   auto k = contexts_.back();
   constraints_.erase(constraints_.begin() + k, constraints_.end());
+  compiled_.erase(compiled_.begin() + k, compiled_.end());
 
-  // add codes removed from sat_ in this context
-  auto& removed = context_unsat_.back();
-  sat_.insert(sat_.begin(), removed.begin(), removed.end());
+  // codes removed in this context lie right behind the live ones
+  for (uint i = num_sat_; i < context_sat_.back(); i++) SetLive(sat_[i], true);
+  num_sat_ = context_sat_.back();
+  applied_ = context_applied_.back();
 
   contexts_.pop_back();
-  context_unsat_.pop_back();
+  context_sat_.pop_back();
+  context_applied_.pop_back();
   ready_ = false;
 }
 
 bool SimpleSolver::_MustBeTrue(VarId id) {
   if (!ready_) Update();
-  for (auto& x : sat_)
-    if (!codes_[x][id]) return false;
+  auto& column = columns_[id];
+  for (uint w = 0; w < words_; w++)
+    if (live_[w] & ~column[w]) return false;
   return true;
 }
 
 bool SimpleSolver::_MustBeFalse(VarId id) {
   if (!ready_) Update();
-  for (auto& x : sat_)
-    if (codes_[x][id]) return false;
+  auto& column = columns_[id];
+  for (uint w = 0; w < words_; w++)
+    if (live_[w] & column[w]) return false;
   return true;
 }
 
@@ -73,75 +174,152 @@ uint SimpleSolver::_GetNumOfFixedVars() {
 
 vec<VarId> SimpleSolver::_GetFixedVars() {
   if (!ready_) Update();
-  vec<bool> canbe[2];
-  canbe[0].resize(var_count_);
-  canbe[1].resize(var_count_);
-  for (auto x : sat_)
-    for (uint i = 1; i < var_count_; i++)
-      canbe[codes_[x][i]][i] = true;
   vec<VarId> result;
   for (uint i = 1; i < var_count_; i++) {
-    if (!canbe[0][i]) result.push_back(i);
-    if (!canbe[1][i]) result.push_back(-i);
+    // canbe_true/canbe_false accumulate live codes with the variable set/unset
+    auto& column = columns_[i];
+    uint64_t canbe_true = 0, canbe_false = 0;
+    for (uint w = 0; w < words_ && !(canbe_true && canbe_false); w++) {
+      canbe_true |= live_[w] & column[w];
+      canbe_false |= live_[w] & ~column[w];
+    }
+    if (!canbe_false) result.push_back(i);
+    if (!canbe_true) result.push_back(-i);
   }
   return result;
 }
 
+uint64_t SimpleSolver::EvaluateWord(uint word, vec<uint64_t>& regs) const {
+  auto result = live_[word];
+  for (uint i = applied_; i < compiled_.size() && result; i++)
+    result &= compiled_[i].Evaluate(columns_, word, regs);
+  return result;
+}
+
+void SimpleSolver::Remove(uint i) {
+  assert(i < num_sat_);
+  SetLive(sat_[i], false);
+  std::swap(sat_[i], sat_[--num_sat_]);
+}
+
 bool SimpleSolver::TestSat(uint i) {
-  assert(i < sat_.size());
-  bool ok = true;
-  for (auto& constr : constraints_) {
-    if (!constr.first->Satisfied(codes_[sat_[i]], constr.second)) {
-      ok = false;
-      break;
-    }
-  }
-  if (ok) return true;
-  if (!context_unsat_.empty())
-    context_unsat_.back().push_back(sat_[i]);
-  sat_[i] = sat_.back();
-  sat_.pop_back();
+  assert(i < num_sat_);
+  auto x = sat_[i];
+  if ((EvaluateWord(x / 64, regs_) >> (x % 64)) & 1) return true;
+  Remove(i);
   return false;
 }
 
 void SimpleSolver::RemoveUntilSat(uint start) {
-  while (sat_.size() > start && !TestSat(start))
+  while (num_sat_ > start && !TestSat(start))
     // TestSat removes the unsat code from sat
     {}
 }
 
 bool SimpleSolver::_Satisfiable() {
   RemoveUntilSat(0);
-  return !sat_.empty();
+  return num_sat_ > 0;
 }
 
 bool SimpleSolver::_OnlyOneModel() {
-  assert(sat_.size() > 0);
+  assert(num_sat_ > 0);
   RemoveUntilSat(1);
-  return sat_.size() == 1;
+  return num_sat_ == 1;
 }
 
 vec<bool> SimpleSolver::GetModel() {
-  assert(!sat_.empty());
-  return codes_[sat_[0]];
+  assert(num_sat_ > 0);
+  return Code(sat_[0]);
 }
 
 uint SimpleSolver::_NumOfModels() {
   if (!ready_) Update();
-  return sat_.size();
+  return num_sat_;
+}
+
+uint SimpleSolver::_NumOfModelsUpTo(uint limit) {
+  if (ready_) return std::min(num_sat_, limit);
+  // counting pass that stops at the limit; no code is removed
+  uint count = 0;
+  for (uint w = 0; w < words_ && count < limit; w++)
+    count += popcount(EvaluateWord(w, regs_));
+  return std::min(count, limit);
 }
 
 vec<vec<bool>> SimpleSolver::_GenerateModels() {
   if (!ready_) Update();
   vec<vec<bool>> result;
-  for (auto x : sat_)
-    result.push_back(codes_[x]);
+  for (uint i = 0; i < num_sat_; i++)
+    result.push_back(Code(sat_[i]));
   return result;
 }
 
+void SimpleSolver::_PartitionByOutcome(const ExpType& type,
+                                       const vec<CharId>& params,
+                                       vec<uint>* models, vec<uint>* fixed) {
+  if (!ready_) Update();
+  auto& outcomes = type.outcomes();
+  if (models) models->assign(outcomes.size(), 0);
+
+  // counting pass over the precomputed outcomes of the live codes
+  auto column = table_ && models ? table_->Column(type, params) : nullptr;
+  if (column) {
+    for (uint i = 0; i < num_sat_; i++) {
+      auto cell = column[sat_[i]];
+      if (cell != OutcomeTable::kNoOutcome) (*models)[cell]++;
+    }
+    if (!fixed) return;
+    models = nullptr;
+  }
+
+  vec<CompiledFormula> compiled;
+  for (auto& o : outcomes)
+    compiled.push_back(CompiledFormula(o.formula, &params));
+  // canbe[o][2 * id + b]: variable 'id' has value b in some code of outcome o
+  vec<vec<uint64_t>> canbe;
+  if (fixed) canbe.assign(outcomes.size(), vec<uint64_t>(2 * var_count_, 0));
+
+  // single pass over the live codes, 64 codes at a time
+  for (uint w = 0; w < words_; w++) {
+    if (!live_[w]) continue;
+    for (uint o = 0; o < outcomes.size(); o++) {
+      auto part = live_[w] & compiled[o].Evaluate(columns_, w, regs_);
+      if (!part) continue;
+      if (models) (*models)[o] += popcount(part);
+      if (!fixed) continue;
+      for (uint id = 1; id < var_count_; id++) {
+        canbe[o][2 * id] |= part & ~columns_[id][w];
+        canbe[o][2 * id + 1] |= part & columns_[id][w];
+      }
+    }
+  }
+
+  if (!fixed) return;
+  fixed->assign(outcomes.size(), 0);
+  for (uint o = 0; o < outcomes.size(); o++)
+    for (uint id = 1; id < var_count_; id++)
+      (*fixed)[o] += !canbe[o][2 * id] + !canbe[o][2 * id + 1];
+}
+
 void SimpleSolver::Update() {
-  for (int i = sat_.size() - 1; i >= 0; i--)
-    TestSat(i);
+  // evaluate all constraints on 64 codes at once, then drop failing codes;
+  // with a thread pool, every thread evaluates its own range of words
+  vec<uint64_t> ok(words_);
+  if (pool_ && words_ >= kMinWordsPerThread * pool_->size()) {
+    uint n = pool_->size();
+    pool_->Run([&](uint t) {
+      for (uint w = words_ * t / n; w < words_ * (t + 1) / n; w++)
+        ok[w] = EvaluateWord(w, pool_regs_[t]);
+    });
+  } else {
+    for (uint w = 0; w < words_; w++)
+      ok[w] = EvaluateWord(w, regs_);
+  }
+  for (int i = num_sat_ - 1; i >= 0; i--) {
+    auto x = sat_[i];
+    if (!((ok[x / 64] >> (x % 64)) & 1)) Remove(i);
+  }
+  applied_ = compiled_.size();
   ready_ = true;
 }
 
@@ -5,6 +5,7 @@
  */
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <utility>
@@ -12,12 +13,17 @@
 #include <set>
 #include "./common.h"
 #include "./solver.h"
+#include "./compiled-formula.h"
+#include "./outcome-table.h"
+#include "./simple-cache.h"
+#include "./thread-pool.h"
 
 #ifndef COBRA_SRC_SIMPLE_SOLVER_H_
 #define COBRA_SRC_SIMPLE_SOLVER_H_
 
 class Variable;
 class Formula;
+class Game;
 
 class SimpleSolver: public Solver {
   static SolverStats stats_;
@@ -25,15 +31,73 @@ class SimpleSolver: public Solver {
   Formula* constraint_;
 
   vec<std::pair<Formula*, vec<CharId>>> constraints_;
+  vec<CompiledFormula> compiled_;  // compiled_[i] is constraints_[i] compiled
   vec<int> contexts_;
 
-  vec<vec<bool>> codes_;
-  vec<vec<uint>> context_unsat_;
+  // The live codes (those satisfying all constraints) are the first num_sat_
+  // entries of sat_, a permutation of all codes. Removed codes are swapped
+  // right behind the live ones, so closing a context only moves num_sat_
+  // back to the watermark saved when the context was opened.
   vec<uint> sat_;
+  uint num_sat_;
+  vec<uint> context_sat_;
   bool ready_;
+  // The live codes satisfy the first applied_ constraints; only the other
+  // ones need to be evaluated.
+  uint applied_ = 0;
+  vec<uint> context_applied_;
+
+  // Codes are stored column-major (bit-sliced): for every variable, a bitset
+  // over all codes packed into 64-bit words. Bits of live_ are set exactly
+  // for the live codes.
+  uint num_codes_;
+  uint words_;
+  vec<vec<uint64_t>> columns_;
+  vec<uint64_t> live_;
+  vec<uint64_t> regs_;  // scratch registers for CompiledFormula::Evaluate
+
+  // Optional threads for Update; every thread has its own registers.
+  // Smaller code sets than kMinWordsPerThread words per thread are filtered
+  // serially, as waking the threads would cost more than it saves.
+  static const uint kMinWordsPerThread = 64;
+  ThreadPool* pool_ = nullptr;
+  vec<vec<uint64_t>> pool_regs_;
+
+  OutcomeTable* table_ = nullptr;
+  SimpleCache* cache_ = nullptr;  // backs table_ if loaded from a cache
 
  public:
   SimpleSolver(uint var_count, Formula* constraint = nullptr);
+  ~SimpleSolver();
+
+  /**
+   * Creates a solver for 'game' with the code set (and the outcome table,
+   * if max_cells > 0) loaded from the cache file 'filename'. If the file
+   * is missing or belongs to a different version of the game, the codes
+   * are enumerated as usual and the cache is rewritten.
+   */
+  static SimpleSolver* LoadCached(const string& filename, const Game& game,
+                                  uint64_t max_cells);
+
+  /**
+   * Precomputes the outcomes of all experiments of 'game' on all codes
+   * (see OutcomeTable), as long as the table has at most 'max_cells' cells.
+   * Model counting for experiments in the table then needs no formula
+   * evaluation.
+   */
+  void PrecomputeOutcomes(const Game& game, uint64_t max_cells);
+  const OutcomeTable* outcome_table() const { return table_; }
+
+  /**
+   * Returns true if the codes were mapped from a cache file (see LoadCached).
+   */
+  bool from_cache() const { return cache_ != nullptr; }
+
+  /**
+   * Sets the number of threads used to filter codes by new constraints.
+   * The result does not depend on the number of threads.
+   */
+  void SetThreads(uint threads);
 
   SolverStats& stats() { return stats_; }
   static SolverStats& s_stats() { return stats_; }
@@ -53,13 +117,26 @@ class SimpleSolver: public Solver {
   bool _OnlyOneModel();
 
   vec<bool> GetModel();
+  bool PartitionsInOnePass() const { return true; }
 
   uint _NumOfModels();
+  uint _NumOfModelsUpTo(uint limit);
   vec<vec<bool>> _GenerateModels();
+  void _PartitionByOutcome(const ExpType& type,
+                           const vec<CharId>& params,
+                           vec<uint>* models, vec<uint>* fixed);
 
   string pretty();
 
  private:
+  // Takes the codes from 'cache' (and takes ownership of it).
+  SimpleSolver(uint var_count, Formula* constraint, SimpleCache* cache);
+
+  void Init(vec<vec<uint64_t>>&& columns, uint num_codes);
+  vec<bool> Code(uint code) const;
+  void SetLive(uint code, bool value);
+  uint64_t EvaluateWord(uint word, vec<uint64_t>& regs) const;
+  void Remove(uint i);
   bool TestSat(uint i);
   void RemoveUntilSat(uint start);
   void Update();
@@ -5,7 +5,18 @@
  */
 
 #include "./solver.h"
+
+#include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
 #include "./formula.h"
+#include "./experiment.h"
+#include "./model-counter.h"
+#include "./preprocessor.h"
 
 // Time-measuring wrappers
 
@@ -49,6 +60,14 @@ bool Solver::Satisfiable() {
   return result;
 }
 
+bool Solver::SatisfiableWith(Formula* formula, const vec<CharId>& params) {
+  auto t1 = clock();
+  auto result = _SatisfiableWith(formula, params);
+  stats().sat_calls++;
+  stats().sat_time += clock() - t1;
+  return result;
+}
+
 bool Solver::OnlyOneModel() {
   auto t1 = clock();
   auto result = _OnlyOneModel();
@@ -65,6 +84,14 @@ uint Solver::NumOfModels() {
   return result;
 }
 
+uint Solver::NumOfModelsUpTo(uint limit) {
+  auto t1 = clock();
+  auto result = _NumOfModelsUpTo(limit);
+  stats().models_calls++;
+  stats().models_time += clock() - t1;
+  return result;
+}
+
 vec<vec<bool>> Solver::GenerateModels() {
   auto t1 = clock();
   auto result = _GenerateModels();
@@ -73,19 +100,523 @@ vec<vec<bool>> Solver::GenerateModels() {
   return result;
 }
 
+void Solver::PartitionByOutcome(const ExpType& type,
+                                const vec<CharId>& params,
+                                vec<uint>* models, vec<uint>* fixed) {
+  auto t1 = clock();
+  _PartitionByOutcome(type, params, models, fixed);
+  if (models) {
+    stats().models_calls++;
+    stats().models_time += clock() - t1;
+  } else {
+    stats().fixed_calls++;
+    stats().fixed_time += clock() - t1;
+  }
+}
+
+uint Solver::_NumOfModelsUpTo(uint limit) {
+  return std::min(_NumOfModels(), limit);
+}
+
+bool Solver::_SatisfiableWith(Formula* formula, const vec<CharId>& params) {
+  OpenContext();
+  AddConstraint(formula, params);
+  auto result = _Satisfiable();
+  CloseContext();
+  return result;
+}
+
+void Solver::_PartitionByOutcome(const ExpType& type,
+                                 const vec<CharId>& params,
+                                 vec<uint>* models, vec<uint>* fixed) {
+  auto& outcomes = type.outcomes();
+  if (models) models->assign(outcomes.size(), 0);
+  if (fixed) fixed->assign(outcomes.size(), 0);
+  for (uint i = 0; i < outcomes.size(); i++) {
+    OpenContext();
+    AddConstraint(outcomes[i].formula, params);
+    if (models) (*models)[i] = _NumOfModels();
+    if (fixed) (*fixed)[i] = _GetNumOfFixedVars();
+    CloseContext();
+  }
+}
 
 // Adding general constraints in CnfSolver
 
+namespace {
+  // Size of the cache of encodings; unused ones are dropped when full.
+  const uint kMaxEncodings = 1 << 12;
+  // Number of preprocessed base constraints kept; all are dropped when full.
+  const uint kMaxPreprocessed = 1 << 4;
+  // Number of guarded encodings kept; the unassumed ones are disabled when
+  // full.
+  const uint kMaxSelectors = 1 << 12;
+  // Number of recent models kept to answer satisfiability queries.
+  const uint kMaxModels = 1 << 5;
+  // Largest limit of NumOfModelsUpTo answered by enumerating the models.
+  const uint kMaxEnumerated = 1 << 8;
+}  // namespace
+
+std::map<vec<vec<VarId>>, CnfSolver::Encoding> CnfSolver::preprocessed_;
+std::mutex CnfSolver::preprocessed_mutex_;
+
 void CnfSolver::AddConstraint(Formula* formula) {
   assert(formula);
+  if (preprocessing_ && !recording_ && clauses_.empty() &&
+      contexts_.empty()) {
+    AddPreprocessed(formula);
+    return;
+  }
   formula->ResetTseitinIds();
-  formula->TseitinTransformation(*this, true);
+  formula->TseitinTransformation(*this, true, polarity::kPositive);
 }
 
 void CnfSolver::AddConstraint(Formula* formula, const vec<CharId>& params) {
-  build_for_params_ = &params;
+  if (InBatchContext()) {
+    // the backend only gets the assumption, model counting the clauses
+    auto& guarded = Guard(formula, params);
+    assumptions_.push_back(guarded.selector);
+    counting_only_ = true;
+    AddEncoding(Record(formula, params), guarded.aux, 0);
+    counting_only_ = false;
+    return;
+  }
+  AddEncoding(Record(formula, params));
+}
+
+const CnfSolver::Encoding& CnfSolver::Record(Formula* formula,
+                                             const vec<CharId>& params) {
+  if (encodings_.size() >= kMaxEncodings) encodings_.clear();
+  auto& encoding = encodings_[std::make_pair(formula, params)];
+  if (!encoding.recorded) {
+    recording_ = &encoding;
+    build_for_params_ = &params;
+    AddConstraint(formula);
+    build_for_params_ = nullptr;
+    recording_ = nullptr;
+    encoding.recorded = true;
+  }
+  return encoding;
+}
+
+const CnfSolver::Guarded& CnfSolver::Guard(Formula* formula,
+                                           const vec<CharId>& params) {
+  auto key = std::make_pair(formula, params);
+  for (auto& level : selectors_) {
+    auto it = level.find(key);
+    if (it != level.end()) return it->second;
+  }
+  auto& selectors = selectors_.back();
+  if (selectors.size() >= kMaxSelectors) {
+    // disable the old encodings of this context for good, the backend can
+    // drop them; the assumed ones are still in use
+    std::set<VarId> assumed(assumptions_.begin(), assumptions_.end());
+    for (auto it = selectors.begin(); it != selectors.end(); ) {
+      if (assumed.count(it->second.selector)) {
+        ++it;
+      } else {
+        _AddClause({ -it->second.selector });
+        it = selectors.erase(it);
+      }
+    }
+  }
+  auto& encoding = Record(formula, params);
+  Guarded guarded;
+  guarded.selector = _NewVarId();
+  guarded.aux.resize(encoding.aux_count);
+  for (auto& id : guarded.aux) id = _NewVarId();
+  AddEncoding(encoding, guarded.aux, guarded.selector);
+  return selectors[key] = guarded;
+}
+
+bool CnfSolver::_SatisfiableWith(Formula* formula,
+                                 const vec<CharId>& params) {
+  for (auto& model : models_) {
+    if (model.levels != kAllLevels) continue;
+    if (formula->Satisfied(model.values, params)) {
+      stats().sat_reused++;
+      return true;
+    }
+  }
+  if (Refuted(Record(formula, params))) {
+    stats().sat_propagated++;
+    return false;
+  }
+  assumptions_.push_back(Guard(formula, params).selector);
+  auto result = _Satisfiable();
+  assumptions_.pop_back();
+  return result;
+}
+
+VarId CnfSolver::NewVarId() {
+  if (recording_) return var_count_ + recording_->aux_count++;
+  if (InBatchContext()) OpenBackendContext();
+  return _NewVarId();
+}
+
+void CnfSolver::AddClause(const vec<VarId>& list) {
+  if (recording_) {
+    recording_->clauses.push_back(list);
+    return;
+  }
+  clauses_.push_back(list);
+  fixed_vars_.back().valid = false;
+  ModelsViolated();
+  if (counting_only_) return;
+  if (InBatchContext()) OpenBackendContext();
+  _AddClause(list);
+}
+
+void CnfSolver::AddClause(std::initializer_list<VarId> list) {
+  AddClause(vec<VarId>(list));
+}
+
+bool CnfSolver::BeginCardinality(const vec<VarId>& lits, uint lower,
+                                 uint upper) {
+  // recorded encodings may be replayed in a context, where the constraint
+  // could not be removed from the backend
+  if (cardinality_encoding_ != cardinality::kNative || recording_ ||
+      !contexts_.empty()) {
+    return false;
+  }
+  if (!_AddCardinality(lits, lower, upper)) return false;
+  fixed_vars_.back().valid = false;
+  ModelsViolated();
+  counting_only_ = true;
+  return true;
+}
+
+void CnfSolver::AddEncoding(const Encoding& encoding) {
+  vec<VarId> aux(encoding.aux_count);
+  for (auto& id : aux) id = NewVarId();
+  AddEncoding(encoding, aux, 0);
+}
+
+void CnfSolver::AddEncoding(const Encoding& encoding, const vec<VarId>& aux,
+                            VarId selector) {
+  vec<VarId> clause;
+  for (auto& c : encoding.clauses) {
+    clause.clear();
+    for (auto lit : c) {
+      VarId id = abs(lit);
+      if ((unsigned)id >= var_count_) id = aux[id - var_count_];
+      clause.push_back(lit > 0 ? id : -id);
+    }
+    if (selector) {
+      clause.push_back(-selector);
+      _AddClause(clause);
+    } else {
+      AddClause(clause);
+    }
+  }
+}
+
+void CnfSolver::AddPreprocessed(Formula* formula) {
+  Encoding original;
+  recording_ = &original;
   AddConstraint(formula);
-  build_for_params_ = nullptr;
+  recording_ = nullptr;
+
+  std::lock_guard<std::mutex> lock(preprocessed_mutex_);
+  auto it = preprocessed_.find(original.clauses);
+  if (it == preprocessed_.end()) {
+    if (preprocessed_.size() >= kMaxPreprocessed) preprocessed_.clear();
+    Encoding encoding;
+    encoding.clauses = Preprocess(original.clauses,
+                                  var_count_ + original.aux_count, var_count_,
+                                  &encoding.aux_count);
+    encoding.recorded = true;
+    it = preprocessed_.emplace(original.clauses, encoding).first;
+  }
+  AddEncoding(it->second);
+}
+
+bool CnfSolver::Refuted(const Encoding& encoding) const {
+  const FixedVars* known = nullptr;
+  for (uint i = fixed_vars_.size(); i-- > 0; ) {
+    if (fixed_vars_[i].valid) {
+      known = &fixed_vars_[i];
+      break;
+    }
+  }
+  if (!known) return false;
+  // value of a variable: 1 true, -1 false, 0 unknown
+  vec<int> value(var_count_ + encoding.aux_count, 0);
+  auto value_of = [&](VarId lit) {
+    return lit > 0 ? value[lit] : -value[-lit];
+  };
+  for (auto lit : known->vars) {
+    if (value_of(lit) < 0) return true;
+    value[abs(lit)] = lit > 0 ? 1 : -1;
+  }
+  vec<bool> done(encoding.clauses.size(), false);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint i = 0; i < encoding.clauses.size(); i++) {
+      if (done[i]) continue;
+      VarId unit = 0;
+      uint open = 0;
+      for (auto lit : encoding.clauses[i]) {
+        auto v = value_of(lit);
+        if (v > 0) {
+          done[i] = true;
+          break;
+        }
+        if (v == 0) {
+          unit = lit;
+          open++;
+        }
+      }
+      if (done[i]) continue;
+      if (open == 0) return true;
+      if (open == 1) {
+        value[abs(unit)] = unit > 0 ? 1 : -1;
+        done[i] = changed = true;
+      }
+    }
+  }
+  return false;
+}
+
+void CnfSolver::ModelFound() {
+  if (models_.size() < kMaxModels) {
+    models_.push_back({ GetModel(), kAllLevels });
+    return;
+  }
+  models_[next_model_] = { GetModel(), kAllLevels };
+  next_model_ = (next_model_ + 1) % kMaxModels;
+}
+
+void CnfSolver::ModelsViolated() {
+  for (auto& model : models_)
+    model.levels = std::min<uint>(model.levels, contexts_.size());
+}
+
+void CnfSolver::OpenContext() {
+  contexts_.push_back({ static_cast<uint>(clauses_.size()),
+                        static_cast<uint>(assumptions_.size()), false });
+  fixed_vars_.push_back(FixedVars());
+  if (!InBatchContext()) OpenBackendContext();
+}
+
+void CnfSolver::CloseContext() {
+  assert(!contexts_.empty() && (!batch_ || contexts_.size() > batch_depth_));
+  auto& context = contexts_.back();
+  clauses_.resize(context.clauses);
+  assumptions_.resize(context.assumptions);
+  if (context.backend) {
+    _CloseContext();
+    backend_depth_--;
+    selectors_.pop_back();
+  }
+  contexts_.pop_back();
+  fixed_vars_.pop_back();
+  // models violating only the closed context satisfy the rest
+  for (auto& model : models_)
+    if (model.levels > contexts_.size()) model.levels = kAllLevels;
+}
+
+void CnfSolver::OpenBackendContext() {
+  assert(!contexts_.back().backend);
+  contexts_.back().backend = true;
+  backend_depth_++;
+  selectors_.push_back(Selectors());
+  _OpenContext();
+}
+
+bool CnfSolver::InBatchContext() const {
+  return batch_ && contexts_.size() == batch_depth_ + 1 &&
+         !contexts_.back().backend;
+}
+
+void CnfSolver::BeginBatch() {
+  assert(!batch_);
+  batch_ = true;
+  batch_depth_ = contexts_.size();
+}
+
+void CnfSolver::EndBatch() {
+  assert(batch_ && contexts_.size() == batch_depth_);
+  batch_ = false;
+}
+
+// Fixed variables
+
+vec<VarId> CnfSolver::_GetFixedVars() {
+  auto& top = fixed_vars_.back();
+  if (!top.valid) {
+    top.vars = Backbone();
+    top.valid = true;
+  }
+  return top.vars;
+}
+
+uint CnfSolver::_GetNumOfFixedVars() {
+  return _GetFixedVars().size();
+}
+
+vec<VarId> CnfSolver::Backbone() {
+  vec<VarId> result;
+  if (!_Satisfiable()) {
+    // every value is impossible
+    for (VarId id = 1; (unsigned)id < var_count_; id++) {
+      result.push_back(id);
+      result.push_back(-id);
+    }
+    return result;
+  }
+  auto model = GetModel();
+  vec<bool> fixed(var_count_, false), free(var_count_, false);
+  // variables fixed in an enclosing context stay fixed
+  for (uint i = fixed_vars_.size() - 1; i-- > 0; ) {
+    if (!fixed_vars_[i].valid) continue;
+    for (auto lit : fixed_vars_[i].vars) fixed[abs(lit)] = true;
+    break;
+  }
+  for (VarId id = 1; (unsigned)id < var_count_; id++) {
+    if (fixed[id] || free[id]) continue;
+    fixed[id] = model[id] ? _MustBeTrue(id) : _MustBeFalse(id);
+    if (fixed[id]) continue;
+    auto other = GetModel();
+    for (uint j = id + 1; j < var_count_; j++)
+      if (other[j] != model[j]) free[j] = true;
+  }
+  for (VarId id = 1; (unsigned)id < var_count_; id++)
+    if (fixed[id]) result.push_back(model[id] ? id : -id);
+  return result;
+}
+
+uint CnfSolver::_NumOfModels() {
+  uint64_t result;
+  if (approx_epsilon_ > 0) {
+    result = ApproxNumOfModels();
+  } else {
+    VarId max_var = var_count_ - 1;
+    for (auto& c : clauses_)
+      for (auto lit : c) max_var = std::max(max_var, abs(lit));
+    ModelCounter counter(max_var + 1, var_count_);
+    for (auto& c : clauses_) counter.AddClause(c);
+    result = counter.Count();
+  }
+  return std::min<uint64_t>(result, UINT_MAX);
+}
+
+uint CnfSolver::_NumOfModelsUpTo(uint limit) {
+  // a few models are found faster than all of them are counted
+  if (limit > kMaxEnumerated) return Solver::_NumOfModelsUpTo(limit);
+  uint count = 0;
+  if (limit > 0) {
+    ForAllModels([&](const vec<bool>&) {
+      return ++count < limit;
+    });
+  }
+  return count;
+}
+
+// Approximate model counting
+
+void CnfSolver::SetApproximation(double epsilon, double delta) {
+  assert(epsilon >= 0 && (epsilon == 0 || (delta > 0 && delta < 1)));
+  approx_epsilon_ = epsilon;
+  approx_delta_ = delta;
+}
+
+uint CnfSolver::BoundedNumOfModels(uint limit) {
+  uint count = 0;
+  OpenContext();
+  while (count < limit && _Satisfiable()) {
+    count++;
+    auto model = GetModel();
+    vec<VarId> block;
+    for (VarId id = 1; (unsigned)id < var_count_; id++)
+      block.push_back(model[id] ? -id : id);
+    AddClause(block);
+  }
+  CloseContext();
+  return count;
+}
+
+void CnfSolver::AddXor(const vec<VarId>& vars, bool parity) {
+  if (vars.empty()) {
+    if (parity) AddClause(vec<VarId>());
+    return;
+  }
+  // chain of fresh variables: acc <-> (previous acc xor var)
+  VarId acc = vars[0];
+  for (uint i = 1; i < vars.size(); i++) {
+    VarId x = vars[i], next = NewVarId();
+    AddClause({ -next, acc, x });
+    AddClause({ -next, -acc, -x });
+    AddClause({ next, -acc, x });
+    AddClause({ next, acc, -x });
+    acc = next;
+  }
+  AddClause({ parity ? acc : -acc });
+}
+
+uint64_t CnfSolver::ApproxNumOfModels() {
+  // the cell size limit and the number of estimates as in ApproxMC
+  double eps = approx_epsilon_;
+  uint threshold = 1 + ceil(9.84 * (1 + eps / (1 + eps)) *
+                            (1 + 1 / eps) * (1 + 1 / eps));
+  uint count = BoundedNumOfModels(threshold);
+  if (count < threshold) return count;
+  uint iterations = ceil(17 * log2(3 / approx_delta_));
+
+  uint n = var_count_ - 1;
+  std::bernoulli_distribution coin(0.5);
+  vec<uint64_t> estimates;
+  uint start = 1;  // number of xors that gave the last estimate
+  for (uint it = 0; it < iterations; it++) {
+    // xors[i] is added in the (i + 1)-th nested context
+    vec<std::pair<vec<VarId>, bool>> xors;
+    uint level = 0;
+    auto push = [&]() {
+      if (xors.size() == level) {
+        vec<VarId> vars;
+        for (uint id = 1; id <= n; id++)
+          if (coin(random_)) vars.push_back(id);
+        xors.push_back({ vars, coin(random_) });
+      }
+      OpenContext();
+      AddXor(xors[level].first, xors[level].second);
+      level++;
+    };
+
+    // start the search from the last number of xors, as in ApproxMC2
+    while (level < start) push();
+    uint cell = BoundedNumOfModels(threshold);
+    if (cell >= threshold) {
+      while (cell >= threshold && level < n) {
+        push();
+        cell = BoundedNumOfModels(threshold);
+      }
+    } else {
+      while (level > 1) {
+        CloseContext();
+        level--;
+        auto c = BoundedNumOfModels(threshold);
+        if (c >= threshold) {
+          push();
+          break;
+        }
+        cell = c;
+      }
+    }
+    if (cell > 0 && cell < threshold) {
+      bool overflow = level >= 64 || cell > (UINT64_MAX >> level);
+      estimates.push_back(overflow ? UINT64_MAX : cell * (1ULL << level));
+      start = level;
+    }
+    for (; level > 0; level--) CloseContext();
+  }
+
+  // all estimates failed; we only know there are at least 'threshold'
+  if (estimates.empty()) return threshold;
+  auto median = estimates.begin() + estimates.size() / 2;
+  std::nth_element(estimates.begin(), median, estimates.end());
+  return *median;
 }
 
 bool CnfSolver::_OnlyOneModel() {
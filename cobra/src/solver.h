@@ -5,9 +5,16 @@
  */
 
 #include <cassert>
+#include <climits>
+#include <cstdint>
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <set>
+#include <random>
+#include <utility>
 #include "./common.h"
 
 #ifndef COBRA_SRC_SOLVER_H_
@@ -16,6 +23,7 @@
 class Variable;
 class Formula;
 class Solver;
+class ExpType;
 
 /**
  * Storage for statistics about a SAT solver. There are 3 categories
@@ -24,12 +32,16 @@ class Solver;
  *  - sat (resolving satisfiability)
  *  - models (model counting)
  * For each category, we store number of calls and the total time.
+ * Sat calls answered without running the SAT solver are counted also
+ * separately.
  */
 typedef struct SolverStats {
   clock_t fixed_time = 0;
   int fixed_calls = 0;
   clock_t sat_time = 0;
   int sat_calls = 0;
+  int sat_propagated = 0;  // refuted by unit propagation
+  int sat_reused = 0;      // satisfied by an earlier model
   clock_t models_time = 0;
   int models_calls = 0;
 } SolverStats;
@@ -41,6 +53,9 @@ typedef struct SolverStats {
  * are virtual and should be (re)implemented in a derived class.
  */
 class Solver {
+  // runs the protected queries of its members on separate threads
+  friend class PortfolioSolver;
+
  protected:
   uint var_count_;
 
@@ -111,6 +126,13 @@ class Solver {
    */
   bool Satisfiable();
 
+  /**
+   * Returns true if and only if all current constraints together with a
+   * parametrized formula can be satisfied. The formula is not added.
+   * Time-measuring wrapper.
+   */
+  bool SatisfiableWith(Formula* formula, const vec<CharId>& params);
+
   /**
    * This can be called only right after a successful 'Satisfiable' call.
    * Returns true if the current constraints have only one model.
@@ -124,17 +146,51 @@ class Solver {
    */
   uint NumOfModels();
 
+  /**
+   * Returns the number of models of the current constraints, but at most
+   * 'limit'. Solvers may stop counting as soon as the limit is reached.
+   * Time-measuring wrapper.
+   */
+  uint NumOfModelsUpTo(uint limit);
+
   /**
    * Generates all models of the current constraints.
    * Time-measuring wrapper.
    */
   vec<vec<bool>> GenerateModels();
 
+  /**
+   * Splits the models of the current constraints by the outcomes of an
+   * experiment, given by its type and parametrization.
+   * If 'models' is not null, it is filled with the number of models
+   * satisfying each outcome; if 'fixed' is not null, it is filled with the
+   * number of fixed variables (see GetNumOfFixedVars) under each outcome.
+   * Time-measuring wrapper.
+   */
+  void PartitionByOutcome(const ExpType& type,
+                          const vec<CharId>& params,
+                          vec<uint>* models, vec<uint>* fixed = nullptr);
+
+  /**
+   * Returns true if PartitionByOutcome handles all outcomes in a single
+   * pass; otherwise it costs as much as querying every outcome alone.
+   */
+  virtual bool PartitionsInOnePass() const { return false; }
+
   /**
    * Retrieves the model after a successful 'Satisfiable' call.
    */
   virtual vec<bool> GetModel() = 0;
 
+  /**
+   * Marks a batch of queries on the current constraints, such as the
+   * evaluation of all experiments of one round, so that a solver can keep
+   * its state between the queries. The batch must end in the context
+   * where it began.
+   */
+  virtual void BeginBatch() { }
+  virtual void EndBatch() { }
+
  protected:
   virtual bool _MustBeTrue(VarId id) = 0;
   virtual bool _MustBeFalse(VarId id) = 0;
@@ -144,6 +200,26 @@ class Solver {
   virtual bool _OnlyOneModel() = 0;
   virtual uint _NumOfModels() = 0;
   virtual vec<vec<bool>> _GenerateModels() = 0;
+
+  /**
+   * Generic implementation of _NumOfModelsUpTo by exact counting.
+   */
+  virtual uint _NumOfModelsUpTo(uint limit);
+
+  /**
+   * Generic implementation of _SatisfiableWith, which adds the formula
+   * in a new context.
+   */
+  virtual bool _SatisfiableWith(Formula* formula, const vec<CharId>& params);
+
+  /**
+   * Generic implementation of _PartitionByOutcome, which adds the outcomes
+   * one by one in a new context. Solvers that can assign models to outcomes
+   * in a single pass should override it.
+   */
+  virtual void _PartitionByOutcome(const ExpType& type,
+                                   const vec<CharId>& params,
+                                   vec<uint>* models, vec<uint>* fixed);
 };
 
 /**
@@ -152,6 +228,93 @@ class Solver {
 class CnfSolver: public Solver {
   const vec<CharId>* build_for_params_ = nullptr;
 
+  /**
+   * Clauses of a parametrized constraint, recorded once by the Tseitin
+   * transformation and replayed whenever the constraint is added again.
+   * Variables from var_count_ up are auxiliary: the i-th auxiliary
+   * variable of the encoding is var_count_ + i.
+   */
+  struct Encoding {
+    bool recorded = false;
+    uint aux_count = 0;
+    vec<vec<VarId>> clauses;
+  };
+
+  std::map<std::pair<Formula*, vec<CharId>>, Encoding> encodings_;
+  Encoding* recording_ = nullptr;
+
+  /**
+   * Encoding of a parametrized constraint added to the backend once, with
+   * every clause guarded by the negation of a selector variable, so that
+   * the constraint holds exactly when the selector is assumed. Guarded
+   * clauses stay in the backend with the clauses learnt from them, but
+   * they do not take part in model counting. selectors_[d] holds the
+   * guarded encodings added in backend context d (0 is the top level);
+   * they are dropped when that context is closed.
+   */
+  struct Guarded {
+    VarId selector;
+    vec<VarId> aux;  // ids of the auxiliary variables of the encoding
+  };
+  typedef std::map<std::pair<Formula*, vec<CharId>>, Guarded> Selectors;
+  vec<Selectors> selectors_ = vec<Selectors>(1);
+
+  // Copy of the clauses of all open contexts, for model counting.
+  vec<vec<VarId>> clauses_;
+
+  // Assumptions passed to every query of the backend.
+  vec<VarId> assumptions_;
+
+  // Open contexts; contexts of a query batch (see BeginBatch) are opened
+  // in the backend only when they get a clause that cannot be guarded.
+  struct Context {
+    uint clauses;      // size of clauses_ when the context was opened
+    uint assumptions;  // size of assumptions_ when the context was opened
+    bool backend;      // the context is open in the backend
+  };
+  vec<Context> contexts_;
+  uint backend_depth_ = 0;  // number of contexts open in the backend
+  bool batch_ = false;
+  uint batch_depth_ = 0;  // number of contexts open at BeginBatch
+
+  // Fixed variables (see GetFixedVars) of the top level and of every open
+  // context, computed lazily and invalidated by new clauses.
+  struct FixedVars {
+    bool valid = false;
+    vec<VarId> vars;
+  };
+  vec<FixedVars> fixed_vars_ = vec<FixedVars>(1);
+
+  /**
+   * A recent model found by the backend (see ModelFound). It satisfies the
+   * constraints of the top level and of the first 'levels' - 1 open
+   * contexts; kAllLevels if it satisfies all current constraints.
+   */
+  struct Model {
+    vec<bool> values;
+    uint levels;
+  };
+  static const uint kAllLevels = UINT_MAX;
+  vec<Model> models_;  // bounded pool, the oldest model is replaced
+  uint next_model_ = 0;
+
+  // Parameters of the approximate model counting; epsilon 0 = exact.
+  double approx_epsilon_ = 0;
+  double approx_delta_ = 0;
+  std::mt19937 random_;
+
+  uint cardinality_encoding_ = 0;  // cardinality::kAuto
+  bool counting_only_ = false;  // see BeginCardinality
+  bool preprocessing_ = false;
+  std::atomic<bool> interrupted_{false};
+
+  /**
+   * Base constraints simplified by Preprocess, shared by all instances and
+   * indexed by the clauses of their Tseitin transformation.
+   */
+  static std::map<vec<vec<VarId>>, Encoding> preprocessed_;
+  static std::mutex preprocessed_mutex_;
+
  public:
   /**
    * Gets a parametrization for an ongoing Tseitin transformation,
@@ -162,8 +325,39 @@ class CnfSolver: public Solver {
   /**
    * Adds a clause (disjunction of given variables) as a constraint.
    */
-  virtual void AddClause(const vec<VarId>& list) = 0;
-  virtual void AddClause(std::initializer_list<VarId> list) = 0;
+  void AddClause(const vec<VarId>& list);
+  void AddClause(std::initializer_list<VarId> list);
+
+  /**
+   * Contexts discard the clauses added in them.
+   */
+  void OpenContext();
+  void CloseContext();
+
+  /**
+   * Switches model counting to a hashing-based approximate counter: with
+   * probability at least 1 - delta, the count is within a factor of
+   * (1 + epsilon) from the exact one. Epsilon 0 switches back to exact
+   * counting.
+   */
+  void SetApproximation(double epsilon, double delta);
+
+  /**
+   * Selects the encoding of AtLeast, AtMost and Exactly to clauses (see the
+   * namespace cardinality in formula.h) for constraints added from now on.
+   */
+  void SetCardinalityEncoding(uint encoding) {
+    cardinality_encoding_ = encoding;
+  }
+  uint cardinality_encoding() const { return cardinality_encoding_; }
+
+  /**
+   * Turns on the preprocessing of the base constraint, the first one added
+   * at the top level: its CNF is simplified by variable elimination, which
+   * keeps the original variables, once for all instances. Cardinality
+   * constraints of the base constraint are then always encoded to clauses.
+   */
+  void SetPreprocessing(bool preprocessing) { preprocessing_ = preprocessing; }
 
   /**
    * General constraints are added by Tseitin tranformation to CNF.
@@ -180,7 +374,172 @@ class CnfSolver: public Solver {
   /**
    * Gets an id of a fresh variable, needed during Tseitin tranformation.
    */
-  virtual VarId NewVarId() = 0;
+  VarId NewVarId();
+
+  /**
+   * Passes a constraint 'lower <= (number of true lits) <= upper' from the
+   * top level of the base constraint to the backend, if the native
+   * encoding is selected and the backend propagates such constraints
+   * itself. Returns false if the constraint must be encoded to clauses.
+   * Otherwise, the clauses added until EndCardinality only serve the model
+   * counting and do not reach the backend.
+   */
+  bool BeginCardinality(const vec<VarId>& lits, uint lower, uint upper);
+  void EndCardinality() { counting_only_ = false; }
+
+  /**
+   * Makes a query running on another thread return as soon as possible,
+   * with an arbitrary result that must be ignored (see PortfolioSolver).
+   * Queries keep returning early until ClearInterrupt is called.
+   */
+  void Interrupt() { interrupted_ = true; }
+  void ClearInterrupt() { interrupted_ = false; }
+
+  /**
+   * Starts a batch of queries on the current constraints: until EndBatch,
+   * the contexts opened directly in the current one are not opened in the
+   * backend. Parametrized constraints added to them are guarded (see
+   * Guarded) and only their selectors are assumed, so that the encodings,
+   * the learnt clauses, the phases and the activities of the backend carry
+   * over from one query to the next.
+   */
+  void BeginBatch();
+  void EndBatch();
+
+ protected:
+  /**
+   * Backends check this between slices of their search.
+   */
+  bool interrupted() const { return interrupted_; }
+
+  /**
+   * Backends pass these to every query.
+   */
+  const vec<VarId>& assumptions() const { return assumptions_; }
+
+  /**
+   * Backends call this after every satisfiable query, including those of
+   * GetFixedVars and model enumeration, so that the model can answer later
+   * queries (see _SatisfiableWith).
+   */
+  void ModelFound();
+
+  virtual VarId _NewVarId() = 0;
+  virtual void _AddClause(const vec<VarId>& list) = 0;
+  virtual void _OpenContext() = 0;
+  virtual void _CloseContext() = 0;
+
+  /**
+   * Adds a native cardinality constraint (see BeginCardinality); false if
+   * the backend does not support it.
+   */
+  virtual bool _AddCardinality(const vec<VarId>&, uint, uint) {
+    return false;
+  }
+
+  /**
+   * Counts the models with a native model counter (see ModelCounter)
+   * instead of enumerating them with the SAT solver, or approximately if
+   * set by SetApproximation. Counts are saturated at UINT_MAX.
+   */
+  virtual uint _NumOfModels();
+
+  /**
+   * Computes the fixed variables as the backbone of the current
+   * constraints: candidates are taken from one model and each of them is
+   * tested only once, while every counter-model found by a test removes
+   * further candidates. The result is cached for the current context.
+   */
+  virtual vec<VarId> _GetFixedVars();
+  virtual uint _GetNumOfFixedVars();
+
+  /**
+   * Enumerates the models (see ForAllModels) if the limit is small;
+   * otherwise, counts all models.
+   */
+  virtual uint _NumOfModelsUpTo(uint limit);
+
+  /**
+   * Calls 'callback' for every model of the current constraints, projected
+   * onto the original variables, until it returns false.
+   */
+  virtual void ForAllModels(
+      std::function<bool(const vec<bool>&)> callback) = 0;
+
+  /**
+   * Tries the cheap checks first: the formula may be satisfied by a recent
+   * model, or refuted by unit propagation of the known fixed variables.
+   * Otherwise, assumes the selector of a guarded encoding of the formula
+   * instead of opening a context (see Guard).
+   */
+  virtual bool _SatisfiableWith(Formula* formula, const vec<CharId>& params);
+
+ private:
+  /**
+   * Gets the guarded encoding of a parametrized constraint, adding it to
+   * the innermost backend context if needed.
+   */
+  const Guarded& Guard(Formula* formula, const vec<CharId>& params);
+
+  /**
+   * True if the current context belongs to a query batch and is not open
+   * in the backend.
+   */
+  bool InBatchContext() const;
+  void OpenBackendContext();
+
+  /**
+   * Records the encoding of a parametrized constraint, unless it is
+   * recorded already.
+   */
+  const Encoding& Record(Formula* formula, const vec<CharId>& params);
+
+  /**
+   * Returns true if unit propagation refutes a recorded encoding together
+   * with the fixed variables of the innermost context that has them
+   * computed (see GetFixedVars). The backend is not used.
+   */
+  bool Refuted(const Encoding& encoding) const;
+
+  /**
+   * Marks the models in the pool as not satisfying the current context,
+   * after a constraint is added to it.
+   */
+  void ModelsViolated();
+
+  /**
+   * Adds the clauses of a recorded encoding, with fresh auxiliary
+   * variables or the given ones. With a non-zero 'selector', the clauses
+   * are guarded by it and only passed to the backend.
+   */
+  void AddEncoding(const Encoding& encoding);
+  void AddEncoding(const Encoding& encoding, const vec<VarId>& aux,
+                   VarId selector);
+
+  /**
+   * Adds the base constraint simplified by Preprocess.
+   */
+  void AddPreprocessed(Formula* formula);
+
+  vec<VarId> Backbone();
+
+  /**
+   * Estimates the number of models in the style of ApproxMC: random XOR
+   * constraints split the models into cells, the models of one cell are
+   * enumerated, and the estimate is the size of the cell times the number
+   * of cells. The result is the median of several such estimates.
+   */
+  uint64_t ApproxNumOfModels();
+
+  /**
+   * Counts the models of the current constraints, but at most 'limit'.
+   */
+  uint BoundedNumOfModels(uint limit);
+
+  /**
+   * Adds a constraint that the xor of 'vars' equals 'parity'.
+   */
+  void AddXor(const vec<VarId>& vars, bool parity);
 };
 
 #endif  // COBRA_SRC_SOLVER_H_
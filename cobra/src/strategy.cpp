@@ -6,6 +6,7 @@
 
 #include "./strategy.h"
 
+#include <climits>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -165,8 +166,10 @@ uint breaker::max_models(vec<Experiment>& options) {
   return minimize([](Experiment& o, double min)->double {
     uint max = 0;
     for (uint i = 0; i < o.num_outcomes(); i++) {
+      // cannot have less than min; count only up to the first larger value
+      if (min < UINT_MAX && o.NumOfModelsAtLeast(i, floor(min) + 1))
+        return floor(min) + 1;
       max = std::max(max, o.NumOfModels(i));
-      if (max > min) return max;  // cannot have less than min
     }
     // prefer the experiment with a final outcome satisfiable
     if (o.IsFinalSat()) return max - 0.5;
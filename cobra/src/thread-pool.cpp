@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "./thread-pool.h"
+
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./common.h"
+
+ThreadPool::ThreadPool(uint threads) {
+  assert(threads > 0);
+  for (uint i = 1; i < threads; i++)
+    workers_.push_back(std::thread(&ThreadPool::Work, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& w : workers_) w.join();
+}
+
+void ThreadPool::Run(const std::function<void(uint)>& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = task;
+    pending_ = workers_.size();
+    generation_++;
+  }
+  start_.notify_all();
+  task(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ThreadPool::Work(uint index) {
+  uint seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+    // task_ is not modified until all workers report back
+    task_(index);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) done_.notify_one();
+  }
+}
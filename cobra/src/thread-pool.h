@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2014, Miroslav Klimos <miroslav.klimos@gmail.com>
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./common.h"
+
+#ifndef COBRA_SRC_THREAD_POOL_H_
+#define COBRA_SRC_THREAD_POOL_H_
+
+/**
+ * A fixed set of worker threads that repeatedly run one task in parallel.
+ * The threads are created once and sleep between tasks, so that running
+ * a short task costs little more than waking them up.
+ */
+class ThreadPool {
+  vec<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  std::function<void(uint)> task_;
+  uint generation_ = 0;  // incremented for every task
+  uint pending_ = 0;     // workers still running the current task
+  bool stop_ = false;
+
+ public:
+  /**
+   * Creates a pool of 'threads' threads in total, including the caller.
+   */
+  explicit ThreadPool(uint threads);
+  ~ThreadPool();
+
+  uint size() const { return workers_.size() + 1; }
+
+  /**
+   * Runs task(i) for every i in [0, size()) in parallel and waits until all
+   * of them finish. task(0) runs on the calling thread.
+   */
+  void Run(const std::function<void(uint)>& task);
+
+ private:
+  void Work(uint index);
+};
+
+#endif  // COBRA_SRC_THREAD_POOL_H_
@@ -1,14 +1,77 @@
+#include <unistd.h>
+#include <cstdlib>
 #include <vector>
+#include <functional>
 #include <initializer_list>
 #include "include/gtest/gtest.h"
 #include "../src/formula.h"
 #include "../src/picosolver.h"
 #include "../src/minisolver.h"
 #include "../src/simple-solver.h"
+#include "../src/bdd-solver.h"
+#include "../src/portfolio-solver.h"
+#include "../src/model-counter.h"
+#include "../src/compiled-formula.h"
+#include "../src/experiment.h"
 #include "../src/parser.h"
 
 extern Parser m;
 
+/**
+ * Returns the valuation of variables 1 .. num_vars - 1 in which variable
+ * id has the value of bit id - 1 of code.
+ */
+vec<bool> Valuation(uint code, uint num_vars) {
+  vec<bool> model(num_vars, false);
+  for (uint id = 1; id < num_vars; id++) model[id] = (code >> (id - 1)) & 1;
+  return model;
+}
+
+/**
+ * Counts the valuations of variables 1 .. num_vars - 1 satisfying f by
+ * brute force.
+ */
+uint CountSatisfying(Formula* f, uint num_vars) {
+  uint result = 0;
+  for (uint code = 0; code < (1u << (num_vars - 1)); code++)
+    result += f->Satisfied(Valuation(code, num_vars), vec<CharId>());
+  return result;
+}
+
+/**
+ * Adds each of the constraints to both solvers in a context of its own and
+ * runs check(str, g) while the context is open.
+ */
+void InContexts(Solver& expected, Solver& actual,
+                std::initializer_list<const char*> constraints,
+                const std::function<void(const char*, Formula*)>& check) {
+  for (auto str : constraints) {
+    auto g = Formula::Parse(str);
+    expected.OpenContext();
+    actual.OpenContext();
+    expected.AddConstraint(g);
+    actual.AddConstraint(g);
+    check(str, g);
+    expected.CloseContext();
+    actual.CloseContext();
+  }
+}
+
+/**
+ * Checks that the solvers agree on satisfiability, fixed variables and the
+ * number of models, at the top level and under a few contexts.
+ */
+void ExpectSameAnswers(Solver& expected, Solver& actual) {
+  EXPECT_EQ(expected.NumOfModels(), actual.NumOfModels());
+  EXPECT_EQ(expected.GenerateModels(), actual.GenerateModels());
+  InContexts(expected, actual, { "a & b", "!c & e", "a & !f", "c & d & e" },
+             [&](const char* str, Formula*) {
+    EXPECT_EQ(expected.Satisfiable(), actual.Satisfiable()) << str;
+    EXPECT_EQ(expected.GetFixedVars(), actual.GetFixedVars()) << str;
+    EXPECT_EQ(expected.NumOfModels(), actual.NumOfModels()) << str;
+  });
+}
+
 // Parser tests.
 
 TEST(Parser, UndefinedVariable) {
@@ -26,6 +89,17 @@ TEST(Parser, BasicParse) {
   EXPECT_STREQ("((p1 & p2) -> (a <-> b))", f1->pretty(false).c_str());
 }
 
+TEST(Parser, SharedSubformulas) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  auto f = Formula::Parse("(a -> !b) | (c & (a -> !b))");
+  auto& children = f->children();
+  EXPECT_EQ(children[0], children[1]->children()[1]);
+  EXPECT_NE(children[1], Formula::Parse("c & (a -> !b)"));
+  EXPECT_TRUE(f->Satisfied({ false, true, false, true }, {}));
+  EXPECT_FALSE(f->Satisfied({ false, true, true, false }, {}));
+}
+
 // Tsetitin transformation tests.
 
 TEST(Tseitin, Basic) {
@@ -70,6 +144,37 @@ TEST(Tseitin, Exactly3) {
   EXPECT_FALSE(s.Satisfiable());
 }
 
+TEST(Tseitin, NegatedCardinality) {
+  m.reset();
+  m.game().declareVars({"a", "b"});
+  PicoSolver s1(m.game().vars().size(), Formula::Parse("!AtLeast-1(a, b)"));
+  EXPECT_EQ(1, s1.NumOfModels());
+  PicoSolver s2(m.game().vars().size(), Formula::Parse("!AtMost-1(a, b)"));
+  EXPECT_EQ(1, s2.NumOfModels());
+}
+
+TEST(Tseitin, CardinalityEncodings) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  for (auto op : { "AtLeast-", "AtMost-", "Exactly-" }) {
+    for (uint k = 0; k <= 5; k++) {
+      string card = op + std::to_string(k) + "(b, c | d, !e, a & e, d)";
+      for (auto str : { card, "!" + card, "a <-> " + card }) {
+        auto f = Formula::Parse(str);
+        auto expected = CountSatisfying(f, m.game().vars().size());
+        for (auto encoding : { cardinality::kSequential,
+                               cardinality::kTotalizer,
+                               cardinality::kPairwise }) {
+          PicoSolver s(m.game().vars().size());
+          s.SetCardinalityEncoding(encoding);
+          s.AddConstraint(f);
+          EXPECT_EQ(expected, s.NumOfModels()) << str << " " << encoding;
+        }
+      }
+    }
+  }
+}
+
 TEST(SolverTest, Exactly1) {
   m.reset();
   m.game().declareVars({"a1", "a2", "a3"});
@@ -81,10 +186,34 @@ TEST(SolverTest, Exactly1) {
   EXPECT_FALSE(s.Satisfiable());
 }
 
+// Bit-parallel evaluation tests.
+
+TEST(CompiledFormula, MatchesSatisfied) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  // bit-sliced set of all 32 valuations, code i has variable j set to bit j-1
+  vec<vec<uint64_t>> columns(6, vec<uint64_t>(1, 0));
+  for (uint code = 0; code < 32; code++)
+    for (uint id = 1; id < 6; id++)
+      if ((code >> (id - 1)) & 1) columns[id][0] |= uint64_t(1) << code;
+  vec<uint64_t> regs;
+  for (auto str : { "AtLeast-2(a, b, c, d, e)", "AtMost-1(a, b | c, d)",
+                    "Exactly-2(a, b, !c, d & e)", "Exactly-0(a, b)",
+                    "(a -> b) <-> !(c | d & e)" }) {
+    auto f = Formula::Parse(str);
+    CompiledFormula cf(f, nullptr);
+    auto result = cf.Evaluate(columns, 0, regs);
+    for (uint code = 0; code < 32; code++) {
+      EXPECT_EQ(f->Satisfied(Valuation(code, 6), vec<CharId>()),
+                static_cast<bool>((result >> code) & 1)) << str;
+    }
+  }
+}
+
 // Sat solver tests.
 
 using testing::Types;
-typedef Types<MiniSolver, PicoSolver, SimpleSolver> Implementations;
+typedef Types<MiniSolver, PicoSolver, SimpleSolver, BddSolver> Implementations;
 TYPED_TEST_CASE(SolverTest, Implementations);
 
 template <class T>
@@ -187,6 +316,39 @@ TYPED_TEST(SolverTest, NumOfModelsAtLeast2) {
   EXPECT_EQ(26, s.NumOfModels()); // 2^5 - 5 - 1
 }
 
+TYPED_TEST(SolverTest, NumOfModelsMixedPolarity) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  for (auto str : { "!(a & !b) | (c -> AtMost-1(a, b, d))",
+                    "!AtLeast-2(a | b, !c, d) & (a -> !(b | c))",
+                    "(a <-> !Exactly-1(b, c & d)) | !(c -> AtLeast-1(a, d))",
+                    "!AtMost-1(a & b, c | d, !(a -> d))" }) {
+    auto f = Formula::Parse(str);
+    TypeParam s(m.game().vars().size(), f);
+    EXPECT_EQ(CountSatisfying(f, m.game().vars().size()), s.NumOfModels())
+        << str;
+  }
+}
+
+TYPED_TEST(SolverTest, NumOfModelsUpTo) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  TypeParam s(m.game().vars().size(),
+              Formula::Parse("AtLeast-2(a, b, c, d, e) & (a -> !e)"));
+  for (auto str : { "a | b", "a & e", "c & d" }) {
+    s.OpenContext();
+    s.AddConstraint(Formula::Parse(str), vec<CharId>());
+    uint count = s.NumOfModels();
+    s.CloseContext();
+    for (uint limit : { 0u, 1u, 3u, count, count + 1, 1000u }) {
+      s.OpenContext();
+      s.AddConstraint(Formula::Parse(str), vec<CharId>());
+      EXPECT_EQ(std::min(count, limit), s.NumOfModelsUpTo(limit)) << str;
+      s.CloseContext();
+    }
+  }
+}
+
 // TYPED_TEST(SolverTest, NumOfModelsSharpSat) {
 //   m.reset();
 //   m.game().declareVars({"x1", "x2", "x3", "x4", "x5"});
@@ -239,3 +401,555 @@ TYPED_TEST(SolverTest, NestedContext) {
 }
 
 
+
+TYPED_TEST(SolverTest, FixedVarsContext) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  TypeParam s(m.game().vars().size(), Formula::Parse("a & (b | c)"));
+  EXPECT_EQ(vec<VarId>({ 1 }), s.GetFixedVars());
+  s.OpenContext();
+  s.AddConstraint(Formula::Parse("!b"));
+  EXPECT_EQ(vec<VarId>({ 1, -2, 3 }), s.GetFixedVars());
+  EXPECT_TRUE(s.MustBeTrue(3));
+  s.CloseContext();
+  EXPECT_EQ(vec<VarId>({ 1 }), s.GetFixedVars());
+  EXPECT_FALSE(s.MustBeTrue(3));
+  EXPECT_FALSE(s.MustBeFalse(3));
+}
+
+TYPED_TEST(SolverTest, FixedVarsNested) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  TypeParam s(m.game().vars().size(), Formula::Parse("a | b"));
+  EXPECT_EQ(0, s.GetNumOfFixedVars());
+  s.AddConstraint(Formula::Parse("c"));
+  EXPECT_EQ(vec<VarId>({ 3 }), s.GetFixedVars());
+  s.OpenContext();
+  s.AddConstraint(Formula::Parse("!a & (d -> a)"));
+  s.OpenContext();
+  EXPECT_EQ(vec<VarId>({ -1, 2, 3, -4 }), s.GetFixedVars());
+  s.AddConstraint(Formula::Parse("!b"));
+  EXPECT_EQ(8, s.GetNumOfFixedVars());  // unsatisfiable
+  s.CloseContext();
+  EXPECT_EQ(4, s.GetNumOfFixedVars());
+  s.CloseContext();
+  EXPECT_EQ(vec<VarId>({ 3 }), s.GetFixedVars());
+}
+
+TYPED_TEST(SolverTest, PartitionByOutcome) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  TypeParam s(m.game().vars().size(), Formula::Parse("a | b | c"));
+  auto type = m.game().addExperiment("e", 0);
+  type->addOutcome("ab", Formula::Parse("a & b"));
+  type->addOutcome("not ab", Formula::Parse("!(a & b)"));
+  type->addOutcome("none", Formula::Parse("!a & !b & !c"));
+  vec<uint> models, fixed;
+  s.PartitionByOutcome(*type, vec<CharId>(), &models, &fixed);
+  EXPECT_EQ(vec<uint>({ 2, 5, 0 }), models);
+  EXPECT_EQ(vec<uint>({ 2, 0, 6 }), fixed);
+  EXPECT_EQ(7, s.NumOfModels());
+}
+
+TEST(Experiment, PartitionsOnlyInOnePass) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  auto type = m.game().addExperiment("e", 0);
+  type->addOutcome("ab", Formula::Parse("a & b"));
+  type->addOutcome("not ab", Formula::Parse("!(a & b)"));
+  type->addOutcome("none", Formula::Parse("!a & !b & !c"));
+  // outcomes that are not requested are not computed
+  PicoSolver p(m.game().vars().size(), Formula::Parse("a | b | c"));
+  Experiment e1(p, *type, vec<CharId>(), 0);
+  auto calls = PicoSolver::s_stats().models_calls;
+  EXPECT_EQ(2, e1.NumOfModels(0));
+  EXPECT_EQ(calls + 1, PicoSolver::s_stats().models_calls);
+  calls = PicoSolver::s_stats().fixed_calls;
+  EXPECT_EQ(2, e1.NumOfFixedVars(0));
+  EXPECT_EQ(calls + 1, PicoSolver::s_stats().fixed_calls);
+  // a single pass fills all outcomes
+  SimpleSolver s(m.game().vars().size(), Formula::Parse("a | b | c"));
+  Experiment e2(s, *type, vec<CharId>(), 0);
+  calls = SimpleSolver::s_stats().models_calls;
+  EXPECT_EQ(2, e2.NumOfModels(0));
+  EXPECT_EQ(5, e2.NumOfModels(1));
+  EXPECT_EQ(0, e2.NumOfModels(2));
+  EXPECT_EQ(calls + 1, SimpleSolver::s_stats().models_calls);
+  // ... also when only a lower bound is requested
+  Experiment e3(s, *type, vec<CharId>(), 0);
+  calls = SimpleSolver::s_stats().models_calls;
+  EXPECT_TRUE(e3.NumOfModelsAtLeast(1, 3));
+  EXPECT_FALSE(e3.NumOfModelsAtLeast(0, 3));
+  EXPECT_EQ(5, e3.NumOfModels(1));
+  EXPECT_EQ(calls + 1, SimpleSolver::s_stats().models_calls);
+}
+
+TYPED_TEST(SolverTest, RepeatedParametrizedConstraint) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  m.game().setAlphabet(new vec<string>({ "A", "B", "C" }));
+  vec<Variable*> vars(m.game().vars().begin() + 1, m.game().vars().end());
+  m.game().addMapping("F", &vars);
+  m.set_last_experiment(m.game().addExperiment("two", 2));
+  TypeParam s(m.game().vars().size(), Formula::Parse("AtMost-2(a, b, c)"));
+  auto f = Formula::Parse("F$1 -> F$2");
+  for (int i = 0; i < 3; i++) {
+    for (CharId x = 0; x < 3; x++) {
+      s.OpenContext();
+      s.AddConstraint(f, { x, static_cast<CharId>((x + 1) % 3) });
+      EXPECT_EQ(5, s.NumOfModels());
+      s.AddConstraint(f, { static_cast<CharId>((x + 1) % 3), x });
+      EXPECT_EQ(3, s.NumOfModels());
+      s.CloseContext();
+    }
+  }
+  EXPECT_EQ(7, s.NumOfModels());
+}
+
+TEST(MiniSolver, NativeCardinality) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f"});
+  auto f = Formula::Parse("Exactly-2(a, b, c, d) & AtLeast-2(c, d, !e, f) & "
+                          "AtMost-3(a, c, e, f | b)");
+  MiniSolver s(m.game().vars().size());
+  s.SetCardinalityEncoding(cardinality::kNative);
+  s.AddConstraint(f);
+  PicoSolver p(m.game().vars().size(), f);
+  ExpectSameAnswers(p, s);
+}
+
+TEST(MiniSolver, GenerateModels) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f"});
+  auto f = Formula::Parse("AtLeast-2(a, b, c, d, e) & (f <-> (a | !e)) & "
+                          "(b -> (c | d))");
+  MiniSolver s(m.game().vars().size(), f);
+  PicoSolver p(m.game().vars().size(), f);
+  EXPECT_EQ(p.GenerateModels(), s.GenerateModels());
+  InContexts(p, s, { "a & b", "!c | e", "a -> !f", "c & d & e & f" },
+             [&](const char* str, Formula*) {
+    EXPECT_EQ(p.GenerateModels(), s.GenerateModels()) << str;
+    // assumed selector of a guarded constraint
+    s.BeginBatch();
+    s.OpenContext();
+    p.OpenContext();
+    s.AddConstraint(Formula::Parse("!b"), vec<CharId>());
+    p.AddConstraint(Formula::Parse("!b"), vec<CharId>());
+    EXPECT_EQ(p.GenerateModels(), s.GenerateModels()) << str;
+    s.CloseContext();
+    p.CloseContext();
+    s.EndBatch();
+  });
+}
+
+TEST(MiniSolver, Preprocessing) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f"});
+  auto f = Formula::Parse("Exactly-2(a, b, c, d) & (e <-> (a | f)) & "
+                          "AtMost-1(c & e, d & f, b & !e)");
+  PicoSolver p(m.game().vars().size(), f);
+  // the second instance starts from the snapshot of the first one
+  for (int i = 0; i < 2; i++) {
+    MiniSolver s(m.game().vars().size());
+    s.SetPreprocessing(true);
+    s.AddConstraint(f);
+    ExpectSameAnswers(p, s);
+  }
+  PicoSolver unsat(m.game().vars().size());
+  unsat.SetPreprocessing(true);
+  unsat.AddConstraint(Formula::Parse("(a -> b) & (b -> !a) & a"));
+  EXPECT_FALSE(unsat.Satisfiable());
+  EXPECT_EQ(0, unsat.NumOfModels());
+}
+
+TEST(PicoSolver, SatisfiableWith) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  PicoSolver s(m.game().vars().size(), Formula::Parse("Exactly-2(a, b, c, d)"));
+  vec<Formula*> queries;
+  for (auto str : { "a & b", "!a & !b & !c", "e -> (a & d)", "c & d & a" })
+    queries.push_back(Formula::Parse(str));
+  // the same answers at the top level (with selectors) and in a context
+  for (auto str : { "", "e", "!d" }) {
+    if (*str) s.AddConstraint(Formula::Parse(str));
+    uint models = s.NumOfModels();
+    for (auto q : queries) {
+      bool top = s.SatisfiableWith(q, vec<CharId>());
+      EXPECT_EQ(top, s.SatisfiableWith(q, vec<CharId>())) << str;
+      s.OpenContext();
+      EXPECT_EQ(top, s.SatisfiableWith(q, vec<CharId>())) << str;
+      s.AddConstraint(q, vec<CharId>());
+      EXPECT_EQ(top, s.Satisfiable()) << str;
+      s.CloseContext();
+    }
+    EXPECT_EQ(models, s.NumOfModels()) << str;
+  }
+}
+
+TEST(MiniSolver, SatisfiableWithoutSolving) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  MiniSolver s(m.game().vars().size(), Formula::Parse("a & (b | c)"));
+  auto stats = s.stats();
+  EXPECT_EQ(1, s.GetNumOfFixedVars());
+  // refuted by the fixed variable a
+  EXPECT_FALSE(s.SatisfiableWith(Formula::Parse("!a & d"), vec<CharId>()));
+  EXPECT_EQ(stats.sat_propagated + 1, s.stats().sat_propagated);
+  // satisfied by the model of the last query
+  EXPECT_TRUE(s.Satisfiable());
+  EXPECT_TRUE(s.SatisfiableWith(Formula::Parse("a | e"), vec<CharId>()));
+  EXPECT_EQ(stats.sat_reused + 1, s.stats().sat_reused);
+  // neither
+  EXPECT_FALSE(s.SatisfiableWith(Formula::Parse("!b & !c"), vec<CharId>()));
+  EXPECT_EQ(stats.sat_propagated + 1, s.stats().sat_propagated);
+  EXPECT_EQ(stats.sat_reused + 1, s.stats().sat_reused);
+  // a new constraint invalidates the model
+  s.AddConstraint(Formula::Parse("!e"));
+  EXPECT_FALSE(s.SatisfiableWith(Formula::Parse("e"), vec<CharId>()));
+}
+
+TEST(PicoSolver, ReusesModels) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  PicoSolver s(m.game().vars().size(), Formula::Parse("Exactly-2(a, b, c, d)"));
+  vec<Formula*> queries;
+  for (auto str : { "a & b", "a & c", "a & d", "b & c", "b & d", "c & d" })
+    queries.push_back(Formula::Parse(str));
+  EXPECT_EQ(6, s.GenerateModels().size());
+  auto reused = s.stats().sat_reused;
+  for (auto q : queries) EXPECT_TRUE(s.SatisfiableWith(q, vec<CharId>()));
+  EXPECT_EQ(reused + 6, s.stats().sat_reused);
+  // models that violate a context are only used once it is closed
+  s.OpenContext();
+  s.AddConstraint(Formula::Parse("!a"));
+  EXPECT_FALSE(s.SatisfiableWith(queries[0], vec<CharId>()));
+  s.CloseContext();
+  EXPECT_TRUE(s.SatisfiableWith(queries[0], vec<CharId>()));
+  EXPECT_EQ(reused + 7, s.stats().sat_reused);
+}
+
+TEST(CnfSolver, QueryBatch) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e"});
+  auto f = Formula::Parse("AtLeast-2(a, b, c, d, e) & (a -> !e)");
+  vec<Formula*> queries, nested;
+  for (auto str : { "a & b", "!a & !b & !c", "e -> (a & d)", "c & d & a" })
+    queries.push_back(Formula::Parse(str));
+  for (auto str : { "(a & b) | (c & d & !e)", "!a & (b -> e)" })
+    nested.push_back(Formula::Parse(str));
+  PicoSolver p(m.game().vars().size(), f);
+  MiniSolver s1(m.game().vars().size(), f);
+  PicoSolver s2(m.game().vars().size(), f);
+  for (CnfSolver* s : { static_cast<CnfSolver*>(&s1),
+                        static_cast<CnfSolver*>(&s2) }) {
+    auto batch = [&](const vec<Formula*>& queries) {
+      s->BeginBatch();
+      for (auto q : queries) {
+        s->OpenContext();
+        p.OpenContext();
+        s->AddConstraint(q, vec<CharId>());
+        p.AddConstraint(q, vec<CharId>());
+        EXPECT_EQ(p.NumOfModels(), s->NumOfModels());
+        EXPECT_EQ(p.GetFixedVars(), s->GetFixedVars());
+        EXPECT_EQ(p.GenerateModels(), s->GenerateModels());
+        EXPECT_EQ(p.Satisfiable(), s->Satisfiable());
+        if (p.Satisfiable()) {
+          s->Satisfiable();
+          EXPECT_EQ(p.OnlyOneModel(), s->OnlyOneModel());
+        }
+        // a constraint that is not guarded
+        s->AddConstraint(Formula::Parse("!d"));
+        p.AddConstraint(Formula::Parse("!d"));
+        EXPECT_EQ(p.NumOfModels(), s->NumOfModels());
+        EXPECT_EQ(p.GetFixedVars(), s->GetFixedVars());
+        s->CloseContext();
+        p.CloseContext();
+      }
+      s->EndBatch();
+      EXPECT_EQ(p.NumOfModels(), s->NumOfModels());
+      EXPECT_EQ(p.GetFixedVars(), s->GetFixedVars());
+    };
+    // twice, so that the guarded encodings are reused
+    batch(queries);
+    batch(queries);
+    // a nested batch gets guarded encodings of its own
+    s->OpenContext();
+    p.OpenContext();
+    s->AddConstraint(Formula::Parse("!c | !b"), vec<CharId>());
+    p.AddConstraint(Formula::Parse("!c | !b"), vec<CharId>());
+    batch(nested);
+    auto vars = s->NewVarId();
+    batch(nested);
+    if (s == &s2) {
+      EXPECT_EQ(vars + 1, s->NewVarId());
+    }
+    s->CloseContext();
+    p.CloseContext();
+    batch(queries);
+  }
+}
+
+TEST(CnfSolver, KeepsAssumedSelectors) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  auto f = Formula::Parse("AtLeast-2(a, b, c, d)");
+  PicoSolver p(m.game().vars().size(), f);
+  PicoSolver s(m.game().vars().size(), f);
+  p.AddConstraint(Formula::Parse("a & !b & (c | d)"));
+  s.BeginBatch();
+  s.OpenContext();
+  s.AddConstraint(Formula::Parse("a & !b"), vec<CharId>());
+  // more guarded encodings in the context than are kept, all still assumed
+  for (uint i = 0; i <= (1 << 12); i++) {
+    string str = "c";
+    for (uint bit = 0; bit < 13; bit++)
+      str = ((i >> bit) & 1 ? "d -> (" : "!d -> (") + str + ")";
+    s.AddConstraint(Formula::Parse(str), vec<CharId>());
+  }
+  EXPECT_TRUE(s.Satisfiable());
+  EXPECT_EQ(p.NumOfModels(), s.NumOfModels());
+  EXPECT_EQ(p.SatisfiableWith(Formula::Parse("!c"), vec<CharId>()),
+            s.SatisfiableWith(Formula::Parse("!c"), vec<CharId>()));
+  s.CloseContext();
+  s.EndBatch();
+}
+
+TEST(PortfolioSolver, MatchesSingleSolver) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f"});
+  auto f = Formula::Parse("Exactly-2(a, b, c, d) & (e <-> (a | f)) & "
+                          "AtMost-1(c & e, d & f, b & !e)");
+  PicoSolver p(m.game().vars().size(), f);
+  PortfolioSolver s(m.game().vars().size(), 4);
+  s.AddConstraint(f);
+  ExpectSameAnswers(p, s);
+  InContexts(p, s, { "a & b", "!c & e", "a & !f", "c & d & e", "f" },
+             [&](const char* str, Formula* g) {
+    EXPECT_EQ(p.Satisfiable(), s.Satisfiable()) << str;
+    if (p.Satisfiable()) {
+      s.Satisfiable();
+      auto model = s.GetModel();
+      EXPECT_TRUE(f->Satisfied(model, vec<CharId>()) &&
+                  g->Satisfied(model, vec<CharId>())) << str;
+      EXPECT_EQ(p.OnlyOneModel(), s.OnlyOneModel()) << str;
+    }
+    for (VarId id = 1; id <= 6; id++) {
+      EXPECT_EQ(p.MustBeTrue(id), s.MustBeTrue(id)) << str;
+      EXPECT_EQ(p.MustBeFalse(id), s.MustBeFalse(id)) << str;
+    }
+  });
+}
+
+TEST(PortfolioSolver, QueriesAfterRace) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  PortfolioSolver s(m.game().vars().size(), 4);
+  s.AddConstraint(Formula::Parse("a | b"));
+  for (int i = 0; i < 50; i++) {
+    // the members that lost the race answer the other queries
+    EXPECT_TRUE(s.Satisfiable());
+    EXPECT_EQ(12, s.GenerateModels().size());
+    s.OpenContext();
+    s.AddConstraint(Formula::Parse(i % 2 ? "!a & c" : "!b"));
+    EXPECT_TRUE(s.Satisfiable());
+    EXPECT_EQ(i % 2 ? vec<VarId>({ -1, 2, 3 }) : vec<VarId>({ 1, -2 }),
+              s.GetFixedVars());
+    EXPECT_EQ(i % 2 ? 2 : 4, s.NumOfModels());
+    s.CloseContext();
+  }
+}
+
+TEST(MiniSolver, ReleasesContextVars) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d"});
+  MiniSolver s(m.game().vars().size(), Formula::Parse("a | b"));
+  for (int i = 0; i < 20000; i++) {
+    s.OpenContext();
+    s.AddConstraint(Formula::Parse(i % 2 ? "(a & c) | (b & !d)" : "!a & !c"));
+    EXPECT_TRUE(s.Satisfiable());
+    s.CloseContext();
+  }
+  // the variables of closed contexts are reused
+  EXPECT_GT(10000, s.NewVarId());
+  EXPECT_EQ(12, s.NumOfModels());
+}
+
+// Multithreaded evaluation tests.
+
+TEST(SimpleSolver, ThreadsMatchSerial) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f", "g", "h", "i", "j",
+                        "k", "l", "m", "n", "o", "p"});
+  auto constraint = Formula::Parse("AtMost-12(a, b, c, d, e, f, g, h, i, j, "
+                                   "k, l, m, n, o, p)");
+  auto f1 = Formula::Parse("(a | b) -> AtLeast-3(c, d, e, f, g)");
+  auto f2 = Formula::Parse("Exactly-2(h, i, j) | !k");
+  SimpleSolver serial(m.game().vars().size(), constraint);
+  SimpleSolver parallel(m.game().vars().size(), constraint);
+  parallel.SetThreads(4);
+  for (auto s : { &serial, &parallel }) {
+    s->AddConstraint(f1);
+    s->OpenContext();
+    s->AddConstraint(f2);
+  }
+  EXPECT_EQ(serial.GenerateModels(), parallel.GenerateModels());
+  serial.CloseContext();
+  parallel.CloseContext();
+  EXPECT_EQ(serial.GenerateModels(), parallel.GenerateModels());
+}
+
+// Outcome table tests.
+
+TEST(OutcomeTable, MatchesEvaluation) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  m.game().setAlphabet(new vec<string>({ "A", "B", "C" }));
+  vec<Variable*> vars(m.game().vars().begin() + 1, m.game().vars().end());
+  m.game().addMapping("F", &vars);
+  auto type = m.game().addExperiment("pair", 2);
+  type->paramsDistinct(new vec<uint>({ 1, 2 }));
+  m.set_last_experiment(type);
+  type->addOutcome("both", Formula::Parse("F$1 & F$2"));
+  type->addOutcome("one", Formula::Parse("Exactly-1(F$1, F$2)"));
+  type->addOutcome("none", Formula::Parse("!F$1 & !F$2"));
+
+  SimpleSolver s(m.game().vars().size(), Formula::Parse("AtMost-2(a, b, c)"));
+  s.AddConstraint(Formula::Parse("a | b"));
+  vec<vec<uint>> expected;
+  type->ForAllParametrizations([&](const vec<CharId>& params) {
+    expected.push_back(vec<uint>());
+    s.PartitionByOutcome(*type, params, &expected.back());
+  });
+  EXPECT_EQ(6, expected.size());
+
+  s.PrecomputeOutcomes(m.game(), 1000);
+  EXPECT_EQ(6 * 7, s.outcome_table()->num_cells());
+  uint i = 0;
+  type->ForAllParametrizations([&](const vec<CharId>& params) {
+    EXPECT_TRUE(s.outcome_table()->Column(*type, params));
+    vec<uint> models;
+    s.PartitionByOutcome(*type, params, &models);
+    EXPECT_EQ(expected[i++], models);
+  });
+}
+
+// On-disk cache tests.
+
+TEST(SimpleCache, RoundTrip) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c"});
+  m.game().setAlphabet(new vec<string>({ "A", "B", "C" }));
+  vec<Variable*> vars(m.game().vars().begin() + 1, m.game().vars().end());
+  m.game().addMapping("F", &vars);
+  m.game().addConstraint(Formula::Parse("AtMost-2(a, b, c)"));
+  auto type = m.game().addExperiment("one", 1);
+  m.set_last_experiment(type);
+  type->addOutcome("yes", Formula::Parse("F$1"));
+  type->addOutcome("no", Formula::Parse("!F$1"));
+
+  char dir[] = "/tmp/cobra-test-XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir));
+  const string filename = string(dir) + "/simple-cache-test.cache";
+  for (int run = 0; run < 2; run++) {
+    // the first run writes the cache, the second one maps it
+    SimpleSolver* s = SimpleSolver::LoadCached(filename, m.game(), 1000);
+    EXPECT_EQ(run == 1, s->from_cache());
+    EXPECT_EQ(7, s->NumOfModels());
+    EXPECT_TRUE(s->outcome_table());
+    vec<uint> models;
+    s->PartitionByOutcome(*type, { 1 }, &models);
+    EXPECT_EQ(vec<uint>({ 3, 4 }), models);
+    delete s;
+  }
+  SimpleCache other(filename, m.game().Hash() + 1, m.game().vars().size());
+  EXPECT_FALSE(other.valid());
+  remove(filename.c_str());
+  rmdir(dir);
+}
+
+// BDD solver tests.
+
+TEST(BddSolver, SaturatesNumOfModels) {
+  m.reset();
+  for (uint i = 1; i <= 34; i++)
+    m.game().declareVars({ "x" + std::to_string(i) });
+  BddSolver s(m.game().vars().size(), Formula::Parse("x1 | x2"));
+  // 3 * 2^32 models do not fit
+  EXPECT_EQ(UINT_MAX, s.NumOfModels());
+  s.AddConstraint(Formula::Parse("x1 & x2 & x3"));
+  EXPECT_EQ(uint(1) << 31, s.NumOfModels());
+}
+
+TEST(BddSolver, CollectsGarbage) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f"});
+  auto f = Formula::Parse("AtLeast-2(a, b, c, d, e, f) & (a -> !f)");
+  BddSolver s(m.game().vars().size());
+  s.SetGcLimit(16);
+  s.AddConstraint(f);
+  BddSolver t(m.game().vars().size(), f);
+  PicoSolver p(m.game().vars().size(), f);
+  for (auto str : { "Exactly-3(a, c, e) | b", "c <-> (d | f)", "!b" }) {
+    s.OpenContext();
+    p.OpenContext();
+    t.OpenContext();
+    s.AddConstraint(Formula::Parse(str));
+    p.AddConstraint(Formula::Parse(str));
+    t.AddConstraint(Formula::Parse(str));
+  }
+  // without the lower limit, nothing is collected
+  EXPECT_LT(s.num_nodes(), t.num_nodes());
+  EXPECT_EQ(p.NumOfModels(), s.NumOfModels());
+  EXPECT_EQ(p.GetFixedVars(), s.GetFixedVars());
+  EXPECT_EQ(p.GenerateModels(), s.GenerateModels());
+  for (int i = 0; i < 3; i++) {
+    s.CloseContext();
+    p.CloseContext();
+    EXPECT_EQ(p.NumOfModels(), s.NumOfModels());
+  }
+}
+
+// Model counter tests.
+
+TEST(ModelCounter, Projected) {
+  // x4 <-> (x1 & x2), x5 <-> (x3 | x4); x4 and x5 are auxiliary variables
+  ModelCounter counter(6, 4);
+  counter.AddClause({ -4, 1 });
+  counter.AddClause({ -4, 2 });
+  counter.AddClause({ 4, -1, -2 });
+  counter.AddClause({ -5, 3, 4 });
+  counter.AddClause({ 5, -3 });
+  counter.AddClause({ 5, -4 });
+  EXPECT_EQ(8, counter.Count());
+  counter.AddClause({ 5 });
+  EXPECT_EQ(5, counter.Count());  // x3 | (x1 & x2)
+  counter.AddClause({ -3 });
+  EXPECT_EQ(1, counter.Count());
+  counter.AddClause({});
+  EXPECT_EQ(0, counter.Count());
+}
+
+TEST(ModelCounter, Saturates) {
+  // x1 | ... | x65 has 2^65 - 1 models
+  ModelCounter counter(66, 66);
+  vec<VarId> clause;
+  for (VarId id = 1; id <= 65; id++) clause.push_back(id);
+  counter.AddClause(clause);
+  EXPECT_EQ(UINT64_MAX, counter.Count());
+}
+
+TEST(CnfSolver, ApproxNumOfModels) {
+  m.reset();
+  m.game().declareVars({"a", "b", "c", "d", "e", "f", "g", "h", "i"});
+  MiniSolver s(m.game().vars().size(),
+               Formula::Parse("AtLeast-1(a, b, c, d, e, f, g, h, i)"));
+  s.SetApproximation(0.8, 0.2);
+  auto models = s.NumOfModels();
+  EXPECT_LE(511 / 1.8, models);
+  EXPECT_GE(511 * 1.8, models);
+  // small counts are exact
+  s.OpenContext();
+  s.AddConstraint(Formula::Parse("AtMost-1(a, b, c, d, e, f, g, h, i)"));
+  EXPECT_EQ(9, s.NumOfModels());
+  s.CloseContext();
+}
@@ -90,6 +90,8 @@ Solver::Solver() :
   , order_heap         (VarOrderLt(activity))
   , progress_estimate  (0)
   , remove_satisfied   (true)
+  , card_head          (0)
+  , card_conflict      (CRef_Undef)
 
     // Resource constraints:
     //
@@ -113,6 +115,21 @@ Solver::~Solver()
 //
 Var Solver::newVar(bool sign, bool dvar)
 {
+    if (free_vars.size() > 0){
+        // Reuse a released variable; it occurs in no clause any more.
+        Var v = free_vars.last();
+        free_vars.pop();
+        assigns  [v] = l_Undef;
+        vardata  [v] = mkVarData(CRef_Undef, 0);
+        activity [v] = rnd_init_act ? drand(random_seed) * 0.00001 : 0;
+        seen     [v] = 0;
+        polarity [v] = sign;
+        assert(card_occ_first[toInt(mkLit(v, false))] == -1);
+        assert(card_occ_first[toInt(mkLit(v, true ))] == -1);
+        setDecisionVar(v, dvar);
+        return v;
+    }
+
     int v = nVars();
     watches  .init(mkLit(v, false));
     watches  .init(mkLit(v, true ));
@@ -124,11 +141,22 @@ Var Solver::newVar(bool sign, bool dvar)
     polarity .push(sign);
     decision .push();
     trail    .capacity(v+1);
+    card_occ_first.push(-1);
+    card_occ_first.push(-1);
     setDecisionVar(v, dvar);
     return v;
 }
 
 
+void Solver::releaseVar(Lit l)
+{
+    if (value(l) == l_Undef){
+        addClause(l);
+        released_vars.push(var(l));
+    }
+}
+
+
 bool Solver::addClause_(vec<Lit>& ps)
 {
     assert(decisionLevel() == 0);
@@ -159,6 +187,50 @@ bool Solver::addClause_(vec<Lit>& ps)
 }
 
 
+bool Solver::addAtMost(const vec<Lit>& ps, int k)
+{
+    assert(decisionLevel() == 0);
+    if (!ok) return false;
+
+    // Remove false literals and count true ones:
+    vec<Lit> lits;
+    for (int i = 0; i < ps.size(); i++)
+        if (value(ps[i]) == l_True)
+            k--;
+        else if (value(ps[i]) == l_Undef)
+            lits.push(ps[i]);
+
+    if (k < 0)
+        return ok = false;
+    else if (k >= lits.size())
+        return true;
+    else if (k == 0){
+        for (int i = 0; i < lits.size(); i++)
+            if (!enqueue(~lits[i]))
+                return ok = false;
+        return ok = (propagate() == CRef_Undef);
+    }else if (k == lits.size() - 1){
+        // At least one literal is false:
+        for (int i = 0; i < lits.size(); i++)
+            lits[i] = ~lits[i];
+        return addClause_(lits);
+    }
+
+    int c = card_bound.size();
+    card_start.push(card_lits.size());
+    card_size .push(lits.size());
+    card_bound.push(k);
+    card_count.push(0);
+    for (int i = 0; i < lits.size(); i++){
+        card_lits.push(lits[i]);
+        card_occ_card.push(c);
+        card_occ_next.push(card_occ_first[toInt(lits[i])]);
+        card_occ_first[toInt(lits[i])] = card_occ_card.size() - 1;
+    }
+    return true;
+}
+
+
 void Solver::attachClause(CRef cr) {
     const Clause& c = ca[cr];
     assert(c.size() > 1);
@@ -208,11 +280,18 @@ void Solver::cancelUntil(int level) {
     if (decisionLevel() > level){
         for (int c = trail.size()-1; c >= trail_lim[level]; c--){
             Var      x  = var(trail[c]);
+            if (c < card_head){
+                for (int o = card_occ_first[toInt(trail[c])]; o != -1; o = card_occ_next[o])
+                    card_count[card_occ_card[o]]--; }
             assigns [x] = l_Undef;
             if (phase_saving > 1 || (phase_saving == 1) && c > trail_lim.last())
                 polarity[x] = sign(trail[c]);
             insertVarOrder(x); }
         qhead = trail_lim[level];
+        if (card_head > qhead) card_head = qhead;
+        while (card_implied.size() > 0 && vardata[card_implied.last()].level > level){
+            ca.free(reason(card_implied.last()));
+            card_implied.pop(); }
         trail.shrink(trail.size() - trail_lim[level]);
         trail_lim.shrink(trail_lim.size() - level);
     } }
@@ -451,6 +530,9 @@ CRef Solver::propagate()
     CRef    confl     = CRef_Undef;
     int     num_props = 0;
     watches.cleanAll();
+    if (card_conflict != CRef_Undef){
+        ca.free(card_conflict);
+        card_conflict = CRef_Undef; }
 
     while (qhead < trail.size()){
         Lit            p   = trail[qhead++];     // 'p' is enqueued fact to propagate.
@@ -500,6 +582,13 @@ CRef Solver::propagate()
         NextClause:;
         }
         ws.shrink(i - j);
+
+        if (confl == CRef_Undef && card_bound.size() > 0){
+            confl     = propagateCards(p);
+            card_head = qhead;
+            if (confl != CRef_Undef)
+                qhead = trail.size();
+        }
     }
     propagations += num_props;
     simpDB_props -= num_props;
@@ -508,6 +597,39 @@ CRef Solver::propagate()
 }
 
 
+CRef Solver::propagateCards(Lit p)
+{
+    CRef confl = CRef_Undef;
+    for (int o = card_occ_first[toInt(p)]; o != -1; o = card_occ_next[o]){
+        int c = card_occ_card[o];
+        card_count[c]++;
+        if (confl != CRef_Undef || card_count[c] < card_bound[c])
+            continue;
+
+        // The true literals explain both the conflict and the implications:
+        const Lit* lits = &card_lits[card_start[c]];
+        card_tmp.clear();
+        card_tmp.push(lit_Undef);
+        for (int k = 0; k < card_size[c]; k++)
+            if (value(lits[k]) == l_True)
+                card_tmp.push(~lits[k]);
+
+        if (card_count[c] > card_bound[c]){
+            card_tmp[0] = card_tmp.last();
+            card_tmp.pop();
+            confl = card_conflict = ca.alloc(card_tmp, false);
+        }else
+            for (int k = 0; k < card_size[c]; k++)
+                if (value(lits[k]) == l_Undef){
+                    card_tmp[0] = ~lits[k];
+                    uncheckedEnqueue(~lits[k], ca.alloc(card_tmp, false));
+                    card_implied.push(var(lits[k]));
+                }
+    }
+    return confl;
+}
+
+
 /*_________________________________________________________________________________________________
 |
 |  reduceDB : ()  ->  [void]
@@ -586,8 +708,29 @@ bool Solver::simplify()
 
     // Remove satisfied clauses:
     removeSatisfied(learnts);
-    if (remove_satisfied)        // Can be turned off.
+    if (remove_satisfied){       // Can be turned off.
         removeSatisfied(clauses);
+
+        // Remove all released variables from the trail:
+        for (int i = 0; i < released_vars.size(); i++){
+            assert(seen[released_vars[i]] == 0);
+            seen[released_vars[i]] = 1;
+        }
+
+        int i, j;
+        for (i = j = 0; i < trail.size(); i++)
+            if (seen[var(trail[i])] == 0)
+                trail[j++] = trail[i];
+        trail.shrink(i - j);
+        qhead = card_head = trail.size();
+
+        for (int i = 0; i < released_vars.size(); i++)
+            seen[released_vars[i]] = 0;
+
+        // Released variables are now ready to be reused:
+        append(released_vars, free_vars);
+        released_vars.clear();
+    }
     checkGarbage();
     rebuildOrderHeap();
 
@@ -792,6 +935,30 @@ lbool Solver::solve_()
     return status;
 }
 
+
+bool Solver::implies(const vec<Lit>& assumps, vec<Lit>& out)
+{
+    out.clear();
+    if (!ok || propagate() != CRef_Undef)
+        return ok = false;
+
+    newDecisionLevel();
+    for (int i = 0; i < assumps.size(); i++){
+        Lit a = assumps[i];
+        if (value(a) == l_False){
+            cancelUntil(0);
+            return false;
+        }else if (value(a) == l_Undef)
+            uncheckedEnqueue(a);
+    }
+
+    bool ret = propagate() == CRef_Undef;
+    if (ret)
+        trail.copyTo(out);
+    cancelUntil(0);
+    return ret;
+}
+
 //=================================================================================================
 // Writing CNF to DIMACS:
 // 
@@ -897,6 +1064,11 @@ void Solver::relocAll(ClauseAllocator& to)
             ca.reloc(vardata[v].reason, to);
     }
 
+    // Explanation of the last conflict:
+    //
+    if (card_conflict != CRef_Undef)
+        ca.reloc(card_conflict, to);
+
     // All learnt:
     //
     for (int i = 0; i < learnts.size(); i++)
@@ -44,6 +44,7 @@ public:
     // Problem specification:
     //
     Var     newVar    (bool polarity = true, bool dvar = true); // Add a new variable with parameters specifying variable mode.
+    void    releaseVar(Lit l);                                  // Make literal true and promise to never refer to variable again.
 
     bool    addClause (const vec<Lit>& ps);                     // Add a clause to the solver. 
     bool    addEmptyClause();                                   // Add the empty clause, making the solver contradictory.
@@ -52,6 +53,7 @@ public:
     bool    addClause (Lit p, Lit q, Lit r);                    // Add a ternary clause to the solver. 
     bool    addClause_(      vec<Lit>& ps);                     // Add a clause to the solver without making superflous internal copy. Will
                                                                 // change the passed vector 'ps'.
+    bool    addAtMost (const vec<Lit>& ps, int k);              // Add a constraint that at most 'k' of the (distinct) literals are true.
 
     // Solving:
     //
@@ -63,6 +65,8 @@ public:
     bool    solve        (Lit p, Lit q);            // Search for a model that respects two assumptions.
     bool    solve        (Lit p, Lit q, Lit r);     // Search for a model that respects three assumptions.
     bool    okay         () const;                  // FALSE means solver is in a conflicting state
+    bool    implies      (const vec<Lit>& assumps, vec<Lit>& out); // Unit propagation of the assumptions only: FALSE on a conflict,
+                                                    // otherwise all assigned literals (top-level ones included) are stored in 'out'.
 
     void    toDimacs     (FILE* f, const vec<Lit>& assumps);            // Write CNF to file in DIMACS-format.
     void    toDimacs     (const char *file, const vec<Lit>& assumps);
@@ -189,6 +193,25 @@ protected:
     Heap<VarOrderLt>    order_heap;       // A priority queue of variables ordered with respect to the variable activity.
     double              progress_estimate;// Set by 'search()'.
     bool                remove_satisfied; // Indicates whether possibly inefficient linear scan for satisfied clauses should be performed in 'simplify'.
+    vec<Var>            released_vars;    // Variables released by 'releaseVar()', freed by the next 'simplify()'.
+    vec<Var>            free_vars;        // Variables that can be reused by 'newVar()'.
+
+    // Cardinality constraints (see 'addAtMost()'). Constraint 'c' has literals 'card_lits[card_start[c] ..
+    // card_start[c] + card_size[c] - 1]', of which 'card_count[c]' are true and processed by 'propagate()'.
+    // Implications and conflicts are explained by clauses allocated on demand; the explanations of the
+    // implied variables in 'card_implied' are freed on backtracking.
+    vec<Lit>            card_lits;
+    vec<int>            card_start;
+    vec<int>            card_size;
+    vec<int>            card_bound;
+    vec<int>            card_count;
+    vec<int>            card_occ_first;   // First occurrence of 'lit' in a constraint (or -1), by 'toInt(lit)'.
+    vec<int>            card_occ_card;    // Constraint of each occurrence.
+    vec<int>            card_occ_next;    // Next occurrence of the same literal (or -1).
+    int                 card_head;        // Trail entries before this index are counted in 'card_count'.
+    vec<Var>            card_implied;
+    CRef                card_conflict;    // Explanation of the last conflict of a constraint.
+    vec<Lit>            card_tmp;
 
     ClauseAllocator     ca;
 
@@ -218,6 +241,7 @@ protected:
     void     uncheckedEnqueue (Lit p, CRef from = CRef_Undef);                         // Enqueue a literal. Assumes value of literal is undefined.
     bool     enqueue          (Lit p, CRef from = CRef_Undef);                         // Test if fact 'p' contradicts current state, enqueue otherwise.
     CRef     propagate        ();                                                      // Perform unit propagation. Returns possibly conflicting clause.
+    CRef     propagateCards   (Lit p);                                                 // Count 'p' in its cardinality constraints and propagate them.
     void     cancelUntil      (int level);                                             // Backtrack until a certain level.
     void     analyze          (CRef confl, vec<Lit>& out_learnt, int& out_btlevel);    // (bt = backtrack)
     void     analyzeFinal     (Lit p, vec<Lit>& out_conflict);                         // COULD THIS BE IMPLEMENTED BY THE ORDINARIY "analyze" BY SOME REASONABLE GENERALIZATION?
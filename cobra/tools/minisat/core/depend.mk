@@ -0,0 +1,97 @@
+/root/repo/cobra/tools/minisat/core/Main.o /root/repo/cobra/tools/minisat/core/Main.or /root/repo/cobra/tools/minisat/core/Main.od /root/repo/cobra/tools/minisat/core/Main.op: /root/repo/cobra/tools/minisat/core/Main.cc \
+ /root/repo/cobra/tools/minisat/utils/System.h \
+ /root/repo/cobra/tools/minisat/mtl/IntTypes.h \
+ /root/repo/cobra/tools/minisat/utils/ParseUtils.h \
+ /root/repo/cobra/tools/minisat/utils/Options.h \
+ /root/repo/cobra/tools/minisat/mtl/Vec.h \
+ /root/repo/cobra/tools/minisat/mtl/XAlloc.h \
+ /root/repo/cobra/tools/minisat/core/Dimacs.h \
+ /root/repo/cobra/tools/minisat/core/SolverTypes.h \
+ /root/repo/cobra/tools/minisat/mtl/Alg.h \
+ /root/repo/cobra/tools/minisat/mtl/Map.h \
+ /root/repo/cobra/tools/minisat/mtl/Alloc.h \
+ /root/repo/cobra/tools/minisat/core/Solver.h \
+ /root/repo/cobra/tools/minisat/mtl/Heap.h
+/root/repo/cobra/tools/minisat/core/Solver.o /root/repo/cobra/tools/minisat/core/Solver.or /root/repo/cobra/tools/minisat/core/Solver.od /root/repo/cobra/tools/minisat/core/Solver.op: /root/repo/cobra/tools/minisat/core/Solver.cc \
+ /root/repo/cobra/tools/minisat/mtl/Sort.h \
+ /root/repo/cobra/tools/minisat/mtl/Vec.h \
+ /root/repo/cobra/tools/minisat/mtl/IntTypes.h \
+ /root/repo/cobra/tools/minisat/mtl/XAlloc.h \
+ /root/repo/cobra/tools/minisat/core/Solver.h \
+ /root/repo/cobra/tools/minisat/mtl/Heap.h \
+ /root/repo/cobra/tools/minisat/mtl/Alg.h \
+ /root/repo/cobra/tools/minisat/utils/Options.h \
+ /root/repo/cobra/tools/minisat/utils/ParseUtils.h \
+ /root/repo/cobra/tools/minisat/core/SolverTypes.h \
+ /root/repo/cobra/tools/minisat/mtl/Map.h \
+ /root/repo/cobra/tools/minisat/mtl/Alloc.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/simp/Main.o /Users/mirek/dip/cobra/sat-solvers/minisat/simp/Main.or /Users/mirek/dip/cobra/sat-solvers/minisat/simp/Main.od /Users/mirek/dip/cobra/sat-solvers/minisat/simp/Main.op: /Users/mirek/dip/cobra/sat-solvers/minisat/simp/Main.cc \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/IntTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/ParseUtils.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Vec.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/XAlloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Dimacs.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/SolverTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alg.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Map.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Queue.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Heap.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.o /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.or /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.od /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.op: \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.cc \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Sort.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Vec.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/IntTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/XAlloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/simp/SimpSolver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Queue.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Heap.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alg.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/ParseUtils.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/SolverTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Map.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.o /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.or /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.od /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.op: /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.cc \
+  ../mtl/Sort.h ../mtl/Vec.h ../mtl/IntTypes.h ../mtl/XAlloc.h \
+  ../utils/Options.h ../utils/ParseUtils.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.o /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.or /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.od /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.op: /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.cc \
+  ../utils/System.h ../mtl/IntTypes.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/core/Main.o /Users/mirek/dip/cobra/sat-solvers/minisat/core/Main.or /Users/mirek/dip/cobra/sat-solvers/minisat/core/Main.od /Users/mirek/dip/cobra/sat-solvers/minisat/core/Main.op: /Users/mirek/dip/cobra/sat-solvers/minisat/core/Main.cc \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/IntTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/ParseUtils.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Vec.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/XAlloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Dimacs.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/SolverTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alg.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Map.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Heap.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.o /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.or /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.od /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.op: /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.cc \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Sort.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Vec.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/IntTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/XAlloc.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/Solver.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Heap.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alg.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/utils/ParseUtils.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/core/SolverTypes.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Map.h \
+  /Users/mirek/dip/cobra/sat-solvers/minisat/mtl/Alloc.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.o /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.or /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.od /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.op: /Users/mirek/dip/cobra/sat-solvers/minisat/utils/Options.cc \
+  ../mtl/Sort.h ../mtl/Vec.h ../mtl/IntTypes.h ../mtl/XAlloc.h \
+  ../utils/Options.h ../utils/ParseUtils.h
+/Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.o /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.or /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.od /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.op: /Users/mirek/dip/cobra/sat-solvers/minisat/utils/System.cc \
+  ../utils/System.h ../mtl/IntTypes.h